@@ -19,11 +19,15 @@
 
 ChessboardGrid::ChessboardGrid() = default;
 
-ChessboardGrid::~ChessboardGrid() = default;
+ChessboardGrid::~ChessboardGrid() {
+	// the match's thread is stopped before the listener is destroyed
+	delete mMatchManager;
+}
 
 ChessboardGrid::ChessboardGrid(const ImageProviderCB &images, const ColorProviderCB &colors,
-							   wxWindow *parent, wxWindowID winId, const wxPoint &pos) : ChessboardGrid() {
-	if (!Create(images, colors, parent, winId, pos)) {
+							   wxWindow *parent, wxWindowID winId, const wxPoint &pos,
+							   const EngineConfig &engineConfig) : ChessboardGrid() {
+	if (!Create(images, colors, parent, winId, pos, engineConfig)) {
 #ifdef DEBUG
 		std::cerr << "Cannot create ChessboardGrid" << std::endl;
 #endif
@@ -32,80 +36,42 @@ ChessboardGrid::ChessboardGrid(const ImageProviderCB &images, const ColorProvide
 }
 
 bool ChessboardGrid::Create(const ImageProviderCB &images, const ColorProviderCB &colors,
-                            wxWindow *parent, wxWindowID winId, const wxPoint &pos) {
+                            wxWindow *parent, wxWindowID winId, const wxPoint &pos,
+                            const EngineConfig &engineConfig) {
 	if (!wxPanel::Create(parent, winId, pos))
 		return false;
 
-	mFirstDame = images("firstDame", wxNullBitmap);
-	if (!mFirstDame.IsOk()) return false;
-	auto size = mFirstDame.GetSize();
-	mFirstPawn = images("firstPawn", wxNullBitmap);
-	if (!mFirstPawn.IsOk() || mFirstPawn.GetSize() != size) return false;
-
-	mSecondDame = images("secondDame", wxNullBitmap);
-	if (!mSecondDame.IsOk() || mSecondDame.GetSize() != size) return false;
-
-	mSecondPawn = images("secondPawn", wxNullBitmap);
-	if (!mSecondPawn.IsOk() || mSecondPawn.GetSize() != size) return false;
-
-	mSelected = images("selected", wxNullBitmap);
-	if (!mSelected.IsOk() || mSelected.GetSize() != size) return false;
-
-	mPossibleMove = images("possibleMove", wxNullBitmap);
-	if (!mPossibleMove.IsOk() || mPossibleMove.GetSize() != size) return false;
-
-	wxPanel::SetInitialSize(size * 8);
+	if (!loadTheme(images, colors))
+		return false;
 
-	auto *gridSizer = new wxGridSizer(8, 8, 0, 0);
-	SetSizer(gridSizer);
+	// the theme's size is the preferred one, the board is scaled when the panel is resized
+	wxPanel::SetInitialSize(wxSize(mInitialSquareSize * 8, mInitialSquareSize * 8));
+	wxPanel::SetMinSize(wxSize(MIN_SQUARE_SIZE * 8, MIN_SQUARE_SIZE * 8));
 
 	ChessboardSquare *square;
-	for (int row = 0, i = 0, col; row < 8; row++) {
-		for (col = 0; col < 8; col++, i++) {
-			square = new ChessboardSquare(size.GetWidth(), this, i);
-			if (row % 2 == col % 2) {
-				square->SetBackgroundColour(colors("dark", DEF_DARK_COLOR));
-			} else {
-				square->SetBackgroundColour(colors("light", DEF_LIGHT_COLOR));
-			}
-			square->Bind(wxEVT_LEFT_UP, &ChessboardGrid::OnItemMouseClicked, this);
-			gridSizer->Add(square);
-			mChessboard[i] = square;
-		}
+	for (int i = 0; i < 64; i++) {
+		square = new ChessboardSquare(mInitialSquareSize, this, i);
+		square->Bind(wxEVT_LEFT_UP, &ChessboardGrid::OnItemMouseClicked, this);
+		mChessboard[i] = square;
+		mShownBitmaps[i] = -1;
 	}
 
-	Layout();
+	layoutSquares();
 
-	Bind(wxEVT_MENU, &ChessboardGrid::endStateChange, this, ST_CHNG_EVT_ID);
-	Bind(wxEVT_MENU, &ChessboardGrid::endSquareSelected, this, SQ_SEL_EVT_ID);
-	Bind(wxEVT_MENU, &ChessboardGrid::endSquarePossibleMove, this, SQ_POSS_MOVE_EVT_ID);
-	Bind(wxEVT_MENU, &ChessboardGrid::endSquareClear, this, SQ_CLEAR_EVT_ID);
-	Bind(wxEVT_MENU, &ChessboardGrid::endUpdateDisposition, this, UP_DISP_EVT_ID);
+	Bind(wxEVT_SIZE, &ChessboardGrid::OnSize, this);
 
-	Bind(wxEVT_MENU, &ChessboardGrid::onThreadFinished, this, THREAD_FINISHED_EVT_ID);
+	Bind(wxEVT_MENU, &ChessboardGrid::endStateChange, this, ST_CHNG_EVT_ID);
+	Bind(wxEVT_MENU, &ChessboardGrid::endBoardUpdate, this, BOARD_UPD_EVT_ID);
 
-	mMatchManager = new MatchManager();
+	mMatchManager = new MatchManager(engineConfig);
 	mMatchManager->addEventListener(this);
-	mIsThreadRunning = false;
 
 	return true;
 }
 
 void ChessboardGrid::OnItemMouseClicked(wxMouseEvent &evt) {
-	if (mIsThreadRunning) return;
-
-	int currentPos = evt.GetId();
-	auto *thread = new WorkerThread(this, mMatchManager, currentPos, -1, false, THREAD_FINISHED_EVT_ID);
-	wxThreadError err = thread->Run();
-	if (err == wxTHREAD_NO_ERROR)
-		mIsThreadRunning = true;
-	else {
-		std::cerr << "Cannot execute thread" << std::endl;
-	}
-}
-
-void ChessboardGrid::onThreadFinished(wxCommandEvent &) {
-	mIsThreadRunning = false;
+	// the click is queued, the match manager answers with events
+	mMatchManager->squareClick(evt.GetId());
 }
 
 // begin EventListener callbacks
@@ -116,78 +82,213 @@ void ChessboardGrid::onStateChange(MatchManager::State type) {
 	QueueEvent(evt);
 }
 
-void ChessboardGrid::onSquareSelected(int index) {
-	auto *evt = new wxCommandEvent(wxEVT_MENU, SQ_SEL_EVT_ID);
-	evt->SetInt(index);
-	QueueEvent(evt);
+void ChessboardGrid::onBoardUpdate(const MatchManager::BoardDelta &delta) {
+	std::lock_guard<std::mutex> lock(mPendingMutex);
+	mPendingDelta.merge(delta);
+
+	// the changes are coalesced until the UI thread applies them
+	if (!mIsUpdateQueued) {
+		mIsUpdateQueued = true;
+		QueueEvent(new wxCommandEvent(wxEVT_MENU, BOARD_UPD_EVT_ID));
+	}
 }
 
-void ChessboardGrid::onSquarePossibleMove(int index) {
-	auto *evt = new wxCommandEvent(wxEVT_MENU, SQ_POSS_MOVE_EVT_ID);
-	evt->SetInt(index);
-	QueueEvent(evt);
+// end EventListener callbacks
+
+void ChessboardGrid::endStateChange(wxCommandEvent &evt) {
+	MatchManager::State state = static_cast<MatchManager::State>(evt.GetInt());
+	if (mOnStateChange) mOnStateChange(state);
 }
 
-void ChessboardGrid::onSquareClear() {
-	QueueEvent(new wxCommandEvent(wxEVT_MENU, SQ_CLEAR_EVT_ID));
+void ChessboardGrid::endBoardUpdate(wxCommandEvent &) {
+	MatchManager::BoardDelta delta;
+	{
+		std::lock_guard<std::mutex> lock(mPendingMutex);
+		std::swap(delta, mPendingDelta);
+		mIsUpdateQueued = false;
+	}
+
+	// squares that may have changed, each one is repainted only if its bitmap is different
+	std::vector<int> changed;
+	if (delta.clear) {
+		for (int index: mHighlighted)
+			mHighlights[index] = HIGHLIGHT_NONE;
+		changed.swap(mHighlighted);
+	}
+
+	for (const auto &[index, piece]: delta.pieces) {
+		mPieces[index] = piece;
+		changed.push_back(index);
+	}
+
+	for (int index: delta.possibleMoves) {
+		mHighlights[index] = HIGHLIGHT_POSSIBLE_MOVE;
+		mHighlighted.push_back(index);
+		changed.push_back(index);
+	}
+
+	if (delta.selected != MatchManager::selectedNone) {
+		mHighlights[delta.selected] = HIGHLIGHT_SELECTED;
+		mHighlighted.push_back(delta.selected);
+		changed.push_back(delta.selected);
+	}
+
+	for (int index: changed)
+		updateSquare(index);
 }
 
-void ChessboardGrid::onUpdateDisposition(const GameUtils::Disposition *newDisposition) {
-	auto *evt = new wxCommandEvent(wxEVT_MENU, UP_DISP_EVT_ID);
-	auto *tmp = new GameUtils::Disposition();
-	std::copy(newDisposition->begin(), newDisposition->end(), tmp->begin());
-	evt->SetClientData(tmp);
-	QueueEvent(evt);
+bool ChessboardGrid::loadTheme(const ImageProviderCB &images, const ColorProviderCB &colors) {
+	const std::array<const char *, 6> keys = {"firstDame", "firstPawn", "secondDame", "secondPawn",
+	                                          "selected", "possibleMove"};
+	std::array<wxBitmap, 6> bitmaps;
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		bitmaps[i] = images(keys[i], wxNullBitmap);
+		if (!bitmaps[i].IsOk() || bitmaps[i].GetSize() != bitmaps[0].GetSize()) return false;
+	}
+
+	mFirstDame = bitmaps[0];
+	mFirstPawn = bitmaps[1];
+	mSecondDame = bitmaps[2];
+	mSecondPawn = bitmaps[3];
+	mSelected = bitmaps[4];
+	mPossibleMove = bitmaps[5];
+	mInitialSquareSize = mFirstDame.GetWidth();
+
+	mDarkColor = colors("dark", DEF_DARK_COLOR);
+	mLightColor = colors("light", DEF_LIGHT_COLOR);
+	return true;
 }
 
-// end EventListener callbacks
+bool ChessboardGrid::reloadTheme(const ImageProviderCB &images, const ColorProviderCB &colors) {
+	if (!loadTheme(images, colors))
+		return false;
 
-void ChessboardGrid::endStateChange(wxCommandEvent &evt) {
-	MatchManager::State state = static_cast<MatchManager::State>(evt.GetInt());
-	if (mOnStateChange) mOnStateChange(state);
+	// every atlas is stale, the current square size gets a new one
+	mAtlasDC.SelectObject(wxNullBitmap);
+	mAtlases.clear();
+	mSquareSize = 0;
+
+	InvalidateBestSize();
+	layoutSquares();
+	return true;
 }
 
-void ChessboardGrid::endSquareSelected(wxCommandEvent &evt) {
-	mChessboard[evt.GetInt()]->SetForegroundBitmap(mSelected);
-	wxWindow::Refresh();
+wxSize ChessboardGrid::DoGetBestClientSize() const {
+	return {mInitialSquareSize * 8, mInitialSquareSize * 8};
 }
 
-void ChessboardGrid::endSquarePossibleMove(wxCommandEvent &evt) {
-	mChessboard[evt.GetInt()]->SetForegroundBitmap(mPossibleMove);
-	wxWindow::Refresh();
+void ChessboardGrid::OnSize(wxSizeEvent &evt) {
+	layoutSquares();
+	evt.Skip();
 }
 
-void ChessboardGrid::endSquareClear(wxCommandEvent &) {
+void ChessboardGrid::layoutSquares() {
+	wxSize size = GetClientSize();
+	int squareSize = std::max(std::min(size.GetWidth(), size.GetHeight()) / 8, 1);
+	wxPoint origin((size.GetWidth() - squareSize * 8) / 2, (size.GetHeight() - squareSize * 8) / 2);
+
+	bool resized = squareSize != mSquareSize;
+	if (resized)
+		selectAtlas(squareSize);
+
 	for (int i = 0; i < 64; i++) {
-		mChessboard[i]->SetForegroundBitmap();
+		mChessboard[i]->SetSize(origin.x + (i % 8) * squareSize, origin.y + (i / 8) * squareSize,
+		                        squareSize, squareSize);
+		if (resized)
+			updateSquare(i, true);
 	}
-	wxWindow::Refresh();
 }
 
-void ChessboardGrid::endUpdateDisposition(wxCommandEvent &evt) {
-	auto *disposition = static_cast<GameUtils::Disposition *>(evt.GetClientData());
-	for (int i = 0; i < 64; i++) {
-		mChessboard[i]->SetForegroundBitmap(); // clear square
-		switch (disposition->at(i)) {
-			case GameUtils::EMPTY:
-				mChessboard[i]->SetBackgroundBitmap();
-				break;
-			case GameUtils::PC_PAWN:
-				mChessboard[i]->SetBackgroundBitmap(mIsPcFirstPlayer ? mFirstPawn : mSecondPawn);
-				break;
-			case GameUtils::PC_DAME:
-				mChessboard[i]->SetBackgroundBitmap(mIsPcFirstPlayer ? mFirstDame : mSecondDame);
-				break;
-			case GameUtils::PLAYER_PAWN:
-				mChessboard[i]->SetBackgroundBitmap(mIsPcFirstPlayer ? mSecondPawn : mFirstPawn);
-				break;
-			case GameUtils::PLAYER_DAME:
-				mChessboard[i]->SetBackgroundBitmap(mIsPcFirstPlayer ? mSecondDame : mFirstDame);
-				break;
+void ChessboardGrid::selectAtlas(int squareSize) {
+	mSquareSize = squareSize;
+
+	auto it = std::find_if(mAtlases.begin(), mAtlases.end(), [squareSize](const auto &atlas) {
+		return atlas.first == squareSize;
+	});
+
+	if (it == mAtlases.end()) {
+		mAtlases.emplace(mAtlases.begin(), squareSize, createAtlas(squareSize));
+		if (mAtlases.size() > ATLAS_CACHE_SIZE)
+			mAtlases.pop_back();
+	} else {
+		std::rotate(mAtlases.begin(), it, it + 1);
+	}
+
+	mAtlasDC.SelectObjectAsSource(mAtlases.front().second);
+}
+
+wxBitmap ChessboardGrid::createAtlas(int squareSize) const {
+	auto scale = [squareSize](const wxBitmap &bitmap) {
+		if (!bitmap.IsOk() || bitmap.GetSize() == wxSize(squareSize, squareSize))
+			return bitmap;
+		return wxBitmap(bitmap.ConvertToImage().Scale(squareSize, squareSize, wxIMAGE_QUALITY_HIGH));
+	};
+
+	const std::array<wxBitmap, PIECE_IMAGES> pieces = {wxNullBitmap, scale(mFirstPawn), scale(mFirstDame),
+	                                                   scale(mSecondPawn), scale(mSecondDame)};
+	const std::array<wxBitmap, HIGHLIGHT_COUNT> highlights = {wxNullBitmap, scale(mSelected),
+	                                                          scale(mPossibleMove)};
+
+	wxBitmap atlas(ATLAS_COLUMNS * squareSize, HIGHLIGHT_COUNT * squareSize);
+	wxMemoryDC dc(atlas);
+	dc.SetPen(*wxTRANSPARENT_PEN);
+
+	for (int piece = 0; piece < PIECE_IMAGES; piece++) {
+		for (int highlight = 0; highlight < HIGHLIGHT_COUNT; highlight++) {
+			for (int dark = 0; dark < 2; dark++) {
+				int tile = getTileIndex(piece, static_cast<Highlight>(highlight), dark);
+				wxPoint origin = getTileOrigin(tile, squareSize);
+
+				dc.SetBrush(wxBrush(dark ? mDarkColor : mLightColor));
+				dc.DrawRectangle(origin, wxSize(squareSize, squareSize));
+				if (pieces[piece].IsOk())
+					dc.DrawBitmap(pieces[piece], origin, true);
+				if (highlights[highlight].IsOk())
+					dc.DrawBitmap(highlights[highlight], origin, true);
+			}
 		}
 	}
-	delete disposition;
-	wxWindow::Refresh();
+
+	dc.SelectObject(wxNullBitmap);
+	return atlas;
+}
+
+int ChessboardGrid::getTileIndex(int pieceImage, Highlight highlight, bool dark) {
+	// every row of the atlas contains one highlight
+	return highlight * ATLAS_COLUMNS + pieceImage * 2 + dark;
+}
+
+wxPoint ChessboardGrid::getTileOrigin(int tileIndex, int squareSize) {
+	return {(tileIndex % ATLAS_COLUMNS) * squareSize, (tileIndex / ATLAS_COLUMNS) * squareSize};
+}
+
+void ChessboardGrid::updateSquare(int index, bool force) {
+	bool dark = (index / 8) % 2 == index % 2;
+	int tileIndex = getTileIndex(getPieceImage(mPieces[index]), mHighlights[index], dark);
+	if (!force && mShownBitmaps[index] == tileIndex) return;
+
+	mShownBitmaps[index] = tileIndex;
+	mChessboard[index]->SetTile(&mAtlasDC, getTileOrigin(tileIndex, mSquareSize));
+	mChessboard[index]->Refresh();
+}
+
+int ChessboardGrid::getPieceImage(GameUtils::PieceType piece) const {
+	// 0: none, 1: first pawn, 2: first dame, 3: second pawn, 4: second dame
+	switch (piece) {
+		case GameUtils::PC_PAWN:
+			return mIsPcFirstPlayer ? 1 : 3;
+		case GameUtils::PC_DAME:
+			return mIsPcFirstPlayer ? 2 : 4;
+		case GameUtils::PLAYER_PAWN:
+			return mIsPcFirstPlayer ? 3 : 1;
+		case GameUtils::PLAYER_DAME:
+			return mIsPcFirstPlayer ? 4 : 2;
+		case GameUtils::EMPTY:
+			break;
+	}
+
+	return 0;
 }
 
 void ChessboardGrid::setOnStateChangeCB(const StateChangeCB &listener) {
@@ -195,21 +296,50 @@ void ChessboardGrid::setOnStateChangeCB(const StateChangeCB &listener) {
 }
 
 bool ChessboardGrid::newMatch(int gameDifficulty, bool isPcFirstPlayer) {
-	if (mIsThreadRunning) return false;
+	if (mIsPcFirstPlayer != isPcFirstPlayer) {
+		// the colors of the pieces are swapped, but only the moved pieces are updated by the match manager
+		mIsPcFirstPlayer = isPcFirstPlayer;
+		for (int i = 0; i < 64; i++)
+			updateSquare(i);
+	}
 
-	mIsPcFirstPlayer = isPcFirstPlayer;
+	return mMatchManager->newMatch(gameDifficulty, isPcFirstPlayer);
+}
+
+bool ChessboardGrid::undo() {
+	return mMatchManager->undo();
+}
+
+bool ChessboardGrid::redo() {
+	return mMatchManager->redo();
+}
 
-	auto *thread = new WorkerThread(this, mMatchManager, -1, gameDifficulty, isPcFirstPlayer, THREAD_FINISHED_EVT_ID);
-	wxThreadError err = thread->Run();
-	if (err == wxTHREAD_NO_ERROR)
-		mIsThreadRunning = true;
-	else {
-		std::cerr << "Cannot execute thread" << std::endl;
+bool ChessboardGrid::goToPly(size_t ply) {
+	return mMatchManager->goToPly(ply);
+}
+
+bool ChessboardGrid::showHint() {
+	int from, to;
+	if (!mMatchManager->getHint(from, to)) {
+		// the hint is searched only when it is asked for the first time in the turn
+		mMatchManager->requestHint();
+		return false;
 	}
 
+	// the hint is shown like a selection, so it is removed by the next change
+	mHighlights[from] = HIGHLIGHT_SELECTED;
+	mHighlights[to] = HIGHLIGHT_POSSIBLE_MOVE;
+	mHighlighted.push_back(from);
+	mHighlighted.push_back(to);
+	updateSquare(from);
+	updateSquare(to);
 	return true;
 }
 
+size_t ChessboardGrid::getPlyCount() const {
+	return mMatchManager->getPlyCount();
+}
+
 int ChessboardGrid::getDifficulty() const {
 	return mMatchManager->getDifficulty();
 }
@@ -217,23 +347,3 @@ int ChessboardGrid::getDifficulty() const {
 bool ChessboardGrid::isPlaying() const {
 	return mMatchManager->isPlaying();
 }
-
-ChessboardGrid::WorkerThread::WorkerThread(wxEvtHandler *evtHandler, MatchManager *matchManager, int sqClickIndex, int difficulty, bool isPcFirstPlayer, int id) :
-	wxThread(wxTHREAD_DETACHED) {
-	mEvtHandler = evtHandler;
-	mMatchManager = matchManager;
-	mSqClickIndex = sqClickIndex;
-	mGameDifficulty = difficulty;
-	mIsPcFirstPlayer = isPcFirstPlayer;
-	mThreadID = id;
-}
-
-void *ChessboardGrid::WorkerThread::Entry() {
-	if (mGameDifficulty == -1) // TODO: fix workaround
-		mMatchManager->squareClick(mSqClickIndex);
-	else
-		mMatchManager->newMatch(mGameDifficulty, mIsPcFirstPlayer);
-
-	wxQueueEvent(mEvtHandler, new wxCommandEvent(wxEVT_MENU, mThreadID));
-	return nullptr;
-}
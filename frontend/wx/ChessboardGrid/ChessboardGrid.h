@@ -21,19 +21,20 @@
 #include "ChessboardSquare/ChessboardSquare.h"
 #include "checkers/MatchManager.h"
 #include <wx/wx.h>
+#include <wx/dcmemory.h>
+#include <algorithm>
 #include <functional>
+#include <mutex>
 
 #define ST_CHNG_EVT_ID 1
-#define SQ_SEL_EVT_ID 2
-#define SQ_POSS_MOVE_EVT_ID 3
-#define SQ_CLEAR_EVT_ID 4
-#define UP_DISP_EVT_ID 5
-
-#define THREAD_FINISHED_EVT_ID 20
+#define BOARD_UPD_EVT_ID 2
 
 #define DEF_DARK_COLOR wxColour(32, 32, 32)
 #define DEF_LIGHT_COLOR wxColour(140, 140, 140)
 
+#define MIN_SQUARE_SIZE 24
+#define ATLAS_CACHE_SIZE 3
+
 /**
  * The mission of this class is to provide a wxPanel composed by a 8x8 grid
  */
@@ -43,20 +44,6 @@ public:
 	typedef std::function<const wxColour &(const std::string &, const wxColour &)> ColorProviderCB;
 	typedef std::function<void(enum MatchManager::State type)> StateChangeCB;
 
-	class WorkerThread : public wxThread {
-	public:
-		WorkerThread(wxEvtHandler *evtHandler, MatchManager *matchManager,
-			int sqClickIndex, int mGameDifficulty, bool isPcFirstPlayer, int id);
-
-	private:
-		MatchManager *mMatchManager;
-		int mSqClickIndex, mGameDifficulty, mThreadID;
-		bool mIsPcFirstPlayer;
-		wxEvtHandler *mEvtHandler;
-
-		void *Entry() override;
-	};
-
 	ChessboardGrid();
 
 	~ChessboardGrid() override;
@@ -69,24 +56,62 @@ public:
 	 * @param parent Parent of this wxPanel
 	 * @param winId Window ID, or wxID_ANY
 	 * @param pos Position relative to the parent
+	 * @param engineConfig Configuration of the PC's engine
 	 */
 	ChessboardGrid(const ImageProviderCB &images, const ColorProviderCB &colors, wxWindow *parent,
-	               wxWindowID winId = wxID_ANY, const wxPoint &pos = wxDefaultPosition);
+	               wxWindowID winId = wxID_ANY, const wxPoint &pos = wxDefaultPosition,
+	               const EngineConfig &engineConfig = EngineConfig());
 
 	/**
 	 * Creates a new ChessboardGrid using two-step construction
 	 */
 	bool Create(const ImageProviderCB &images, const ColorProviderCB &colors, wxWindow *parent,
-	            wxWindowID winId = wxID_ANY, const wxPoint &pos = wxDefaultPosition);
+	            wxWindowID winId = wxID_ANY, const wxPoint &pos = wxDefaultPosition,
+	            const EngineConfig &engineConfig = EngineConfig());
 
 	void setOnStateChangeCB(const StateChangeCB &listener);
 
+	/**
+	 * Replaces the bitmaps and the colors of the squares, the match is not affected
+	 * @return False if the new bitmaps are not valid, in that case the current ones are kept
+	 */
+	bool reloadTheme(const ImageProviderCB &images, const ColorProviderCB &colors);
+
 	/**
 	 * Reset the current match
-	 * @return False when the algorithm thread is running
+	 * @return False if the difficulty is not supported
 	 */
 	bool newMatch(int gameDifficulty, bool isPcFirstPlayer);
 
+	/**
+	 * Takes back the player's last move and the PC's reply
+	 * @return False if there is nothing to undo
+	 */
+	bool undo();
+
+	/**
+	 * Makes again the moves taken back
+	 * @return False if there is nothing to redo
+	 */
+	bool redo();
+
+	/**
+	 * Goes to the specified ply of the current match
+	 * @return False if the ply does not exist
+	 */
+	bool goToPly(size_t ply);
+
+	/**
+	 * Highlights the move suggested to the player, until the next change of the chessboard
+	 * @return False if there is no hint yet, its search is started
+	 */
+	bool showHint();
+
+	/**
+	 * @return The number of plies of the current match, including the initial position
+	 */
+	size_t getPlyCount() const;
+
 	/**
 	 * @return Current difficulty
 	 */
@@ -97,51 +122,94 @@ public:
 	 */
 	bool isPlaying() const;
 
+protected:
+	wxSize DoGetBestClientSize() const override;
+
 private:
 	ChessboardGrid(const ChessboardGrid &); // prevents copy-constructor
 	std::array<ChessboardSquare *, 64> mChessboard{};
 
+	enum Highlight {
+		HIGHLIGHT_NONE = 0,
+		HIGHLIGHT_SELECTED,
+		HIGHLIGHT_POSSIBLE_MOVE,
+		HIGHLIGHT_COUNT
+	};
+
+	static const int PIECE_IMAGES = 5; // no piece and the 4 pieces' bitmaps
+	static const int ATLAS_COLUMNS = PIECE_IMAGES * 2;
+
+	/**
+	 * Atlases of the last used square sizes, each one contains a tile for every combination
+	 * of square color, piece and highlight. The most recently used is the first, and it is
+	 * selected in mAtlasDC
+	 */
+	std::vector<std::pair<int, wxBitmap>> mAtlases;
+	wxMemoryDC mAtlasDC;
+	int mSquareSize = 0, mInitialSquareSize = 0;
+	wxColour mDarkColor, mLightColor;
+	std::array<int, 64> mShownBitmaps{}; // tile index shown by each square
+	std::array<Highlight, 64> mHighlights{};
+
 	wxBitmap mFirstPawn = wxNullBitmap, mFirstDame = wxNullBitmap, mSecondPawn = wxNullBitmap, mSecondDame = wxNullBitmap;
 	wxBitmap mSelected = wxNullBitmap, mPossibleMove = wxNullBitmap;
-	GameUtils::MoveList moves; // list of moves the player can do
-	MatchManager *mMatchManager;
+	MatchManager *mMatchManager = nullptr;
 	StateChangeCB mOnStateChange;
-	bool mIsThreadRunning, mIsPcFirstPlayer;
+	bool mIsPcFirstPlayer = false;
+
+	std::mutex mPendingMutex; // protects mPendingDelta and mIsUpdateQueued
+	MatchManager::BoardDelta mPendingDelta;
+	bool mIsUpdateQueued = false;
+	std::vector<int> mHighlighted; // squares with a foreground bitmap
+	std::array<GameUtils::PieceType, 64> mPieces{}; // pieces currently shown
 
 	void OnItemMouseClicked(wxMouseEvent &evt);
-	void onThreadFinished(wxCommandEvent &evt);
+	void OnSize(wxSizeEvent &evt);
 
 	void onStateChange(MatchManager::State type);
-	void onSquareSelected(int index);
-	void onSquarePossibleMove(int index);
-	void onSquareClear();
-	void onUpdateDisposition(const GameUtils::Disposition *newDisposition);
+	void onBoardUpdate(const MatchManager::BoardDelta &delta);
 
 	void endStateChange(wxCommandEvent &evt);
 
 	/**
-	 * Highlight the specified square as selected
-	 * @param index Position of the square
+	 * Applies the changes received since the last update, only the changed squares are refreshed
 	 */
-	void endSquareSelected(wxCommandEvent &evt);
+	void endBoardUpdate(wxCommandEvent &evt);
 
 	/**
-	 * Highlight the specified square as possible move
-	 * @param index Position of the square
+	 * Reads the bitmaps and the colors, the members are changed only if every bitmap is valid
 	 */
-	void endSquarePossibleMove(wxCommandEvent &evt);
+	bool loadTheme(const ImageProviderCB &images, const ColorProviderCB &colors);
+
+	/**
+	 * Places the squares in the largest board that fits the panel, the atlas is changed
+	 * only if the square size changed
+	 */
+	void layoutSquares();
+
+	/**
+	 * Selects the atlas of the given square size, creating it if it is not in the cache
+	 */
+	void selectAtlas(int squareSize);
+
+	/**
+	 * Resamples the pieces and highlights and composites every tile
+	 */
+	wxBitmap createAtlas(int squareSize) const;
+
+	static int getTileIndex(int pieceImage, Highlight highlight, bool dark);
+
+	static wxPoint getTileOrigin(int tileIndex, int squareSize);
 
 	/**
-	 * Clears the foreground bitmap of all 64 squares
+	 * Shows the atlas tile of the square, it is repainted only if the tile changed or if forced
 	 */
-	void endSquareClear(wxCommandEvent &evt);
+	void updateSquare(int index, bool force = false);
 
 	/**
-	 * Updates the disposition of the pieces in the chessboard and clears every border
-	 * @param newDisposition The new disposition to apply
-	 * @param pcIsFirstPlayer True if PC is the first player
+	 * @return The index of the piece's image, or 0 if the square is empty
 	 */
-	void endUpdateDisposition(wxCommandEvent &evt);
+	int getPieceImage(GameUtils::PieceType piece) const;
 };
 
 
@@ -18,6 +18,8 @@
 #include "ChessboardSquare.h"
 
 ChessboardSquare::ChessboardSquare() {
+	// the bitmap covers the whole square, so the background is never erased
+	SetBackgroundStyle(wxBG_STYLE_PAINT);
 	Bind(wxEVT_PAINT, &ChessboardSquare::OnPaint, this);
 }
 
@@ -45,19 +47,13 @@ wxSize ChessboardSquare::DoGetBestClientSize() const {
 void ChessboardSquare::OnPaint(wxPaintEvent &) {
 	wxPaintDC dc(this);
 
-	if (dc.CanDrawBitmap() && mBackBitmap.IsOk()) {
-		dc.DrawBitmap(mBackBitmap, 0, 0);
+	if (dc.CanDrawBitmap() && mAtlas) {
+		wxSize size = GetClientSize();
+		dc.Blit(0, 0, size.GetWidth(), size.GetHeight(), mAtlas, mOrigin.x, mOrigin.y);
 	}
-
-	if (dc.CanDrawBitmap() && mForeBitmap.IsOk()) {
-		dc.DrawBitmap(mForeBitmap, 0, 0);
-	}
-}
-
-void ChessboardSquare::SetBackgroundBitmap(const wxBitmap &bitmap) {
-	mBackBitmap = bitmap;
 }
 
-void ChessboardSquare::SetForegroundBitmap(const wxBitmap &bitmap) {
-	mForeBitmap = bitmap;
+void ChessboardSquare::SetTile(wxDC *atlas, const wxPoint &origin) {
+	mAtlas = atlas;
+	mOrigin = origin;
 }
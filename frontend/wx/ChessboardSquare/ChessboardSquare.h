@@ -28,7 +28,7 @@ public:
 
 	/**
 	 * Creates a new chessboard square
-	 * @param size Square size
+	 * @param size Preferred square size
 	 * @param parent Parent
 	 * @param windowId Window ID
 	 */
@@ -45,16 +45,12 @@ public:
 	            wxWindowID windowId = wxID_ANY);
 
 	/**
-	 * Set the background bitmap (drawn before the other one)
-	 * @param bitmap The new background bitmap
-	 */
-	void SetBackgroundBitmap(const wxBitmap &bitmap = wxNullBitmap);
-
-	/**
-	 * Set the foreground bitmap (drawn after the other one)
-	 * @param bitmap The new foreground bitmap
+	 * Set the tile that covers the whole square, it must be already composited
+	 * (square color, piece and highlight) and scaled so painting is a single blit
+	 * @param atlas The DC of the atlas that contains the tile, or nullptr
+	 * @param origin Top-left corner of the tile in the atlas
 	 */
-	void SetForegroundBitmap(const wxBitmap &bitmap = wxNullBitmap);
+	void SetTile(wxDC *atlas, const wxPoint &origin);
 
 protected:
 	wxSize DoGetBestClientSize() const override;
@@ -63,7 +59,8 @@ private:
 	ChessboardSquare(const ChessboardSquare &); // prevents copy-constructor
 
 	int mSize{};
-	wxBitmap mBackBitmap, mForeBitmap;
+	wxDC *mAtlas = nullptr;
+	wxPoint mOrigin;
 
 	/**
 	 * Paint event
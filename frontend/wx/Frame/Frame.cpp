@@ -23,8 +23,8 @@
 
 Frame::Frame() : resources(DATA_PATH) {}
 
-Frame::Frame(wxWindow *parent, const std::string &theme) : Frame() {
-	if (!Create(parent, theme)) {
+Frame::Frame(wxWindow *parent, const std::string &theme, const EngineConfig &engineConfig) : Frame() {
+	if (!Create(parent, theme, engineConfig)) {
 #ifdef DEBUG
 		std::cerr << "Cannot create Frame" << std::endl;
 #endif
@@ -32,42 +32,33 @@ Frame::Frame(wxWindow *parent, const std::string &theme) : Frame() {
 	}
 }
 
-bool Frame::Create(wxWindow *parent, const std::string &theme) {
+bool Frame::Create(wxWindow *parent, const std::string &theme, const EngineConfig &engineConfig) {
 	if (!wxFrame::Create(parent, wxID_ANY, PROJECT_PRETTY_NAME))
 		return false;
 
 	if (!theme.empty())
-		resources.addTheme(DATA_PATH, theme);
+		resources.addTheme(theme);
 
 	// create chessboard panel that contains the chessboard grid
-	auto *chessboardPanel = createChessboard(this);
+	chessboardPanel = createChessboard(this, engineConfig);
 	if (!chessboardPanel) {
 		return false;
 	}
 
-	// window sizer
-	auto *mainSizer = new wxBoxSizer(wxHORIZONTAL);
-	mainSizer->AddStretchSpacer();
-	mainSizer->Add(chessboardPanel, 0, wxALL, CHESSBOARD_MARGIN_V);
-	mainSizer->AddStretchSpacer();
+	// window sizer, the chessboard is scaled to fit the window keeping its aspect ratio
+	auto *mainSizer = new wxGridSizer(1, 1, 0, 0);
+	mainSizer->Add(chessboardPanel, 0, wxSHAPED | wxALIGN_CENTER | wxALL, CHESSBOARD_MARGIN_V);
 	SetSizer(mainSizer);
 
 	// Menu Bar
 	wxFrame::SetMenuBar(createMenuBar());
 
-	const wxColour &bgColor = resources.getColor("bg");
-	const wxColour &fgColor = resources.getColor("fg");
-
 	// Status Bar
-	wxStatusBar *statusBar = wxFrame::CreateStatusBar();
-	statusBar->SetBackgroundColour(bgColor);
-	statusBar->SetForegroundColour(fgColor);
+	wxFrame::CreateStatusBar();
+	applyColors();
+	watchTheme();
 
-	// Window theme
-	wxWindow::SetBackgroundColour(bgColor);
-	wxWindow::SetForegroundColour(fgColor);
-
-	auto chessboardSize = chessboardPanel->GetMinSize();
+	auto chessboardSize = chessboardPanel->GetBestSize();
 	SetClientSize(wxSize(chessboardSize.GetWidth() + CHESSBOARD_MARGIN_H * 2,
 	                     chessboardSize.GetHeight() + CHESSBOARD_MARGIN_V * 2));
 
@@ -86,44 +77,114 @@ wxMenuBar *Frame::createMenuBar() {
 	menuFile->AppendSeparator();
 	menuFile->Append(wxID_EXIT, _("&Exit"), _("Leave the game"));
 
+	auto *menuEdit = new wxMenu;
+	menuEdit->Append(wxID_UNDO, _("&Undo move\tCtrl+Z"), _("Take back the last move"));
+	menuEdit->Append(wxID_REDO, _("&Redo move\tCtrl+Y"), _("Make again the move taken back"));
+	menuEdit->Append(GO_TO_PLY, _("&Go to move..."), _("Go to a move of the match"));
+	menuEdit->AppendSeparator();
+	menuEdit->Append(SHOW_HINT, _("Show &hint\tCtrl+H"), _("Highlight a good move"));
+
 	auto *menuSettings = new wxMenu;
 	menuSettings->Append(CHANGE_GD, _("Change &difficulty"), _("Change difficulty"));
 	menuSettings->Append(TOGGLE_FIRST_PLAYER, _("&Toggle first player"), _("Toggle first player"));
+	menuSettings->Append(CHANGE_THEME, _("Change t&heme"), _("Change theme"));
 
 	auto *menuHelp = new wxMenu;
 	menuHelp->Append(wxID_ABOUT, _("About " PROJECT_PRETTY_NAME), _("Open about dialog"));
 
 	auto *menuBar = new wxMenuBar;
 	menuBar->Append(menuFile, _("&File"));
+	menuBar->Append(menuEdit, _("&Edit"));
 	menuBar->Append(menuSettings, _("&Settings"));
 	menuBar->Append(menuHelp, _("&Help"));
 
 	menuBar->Bind(wxEVT_MENU, &Frame::newMatchClicked, this, NEW_MATCH);
 	menuBar->Bind(wxEVT_MENU, &Frame::closeFrame, this, wxID_EXIT);
+	menuBar->Bind(wxEVT_MENU, &Frame::undoClicked, this, wxID_UNDO);
+	menuBar->Bind(wxEVT_MENU, &Frame::redoClicked, this, wxID_REDO);
+	menuBar->Bind(wxEVT_MENU, &Frame::goToPlyClicked, this, GO_TO_PLY);
+	menuBar->Bind(wxEVT_MENU, &Frame::hintClicked, this, SHOW_HINT);
 	menuBar->Bind(wxEVT_MENU, &Frame::changeDifficultyClicked, this, CHANGE_GD);
 	menuBar->Bind(wxEVT_MENU, &Frame::flipFirstPlayer, this, TOGGLE_FIRST_PLAYER);
+	menuBar->Bind(wxEVT_MENU, &Frame::changeThemeClicked, this, CHANGE_THEME);
 	menuBar->Bind(wxEVT_MENU, &Frame::aboutClicked, this, wxID_ABOUT);
 
 	return menuBar;
 }
 
-wxPanel *Frame::createChessboard(wxWindow *parent) {
-	auto *chessboardPanel = new wxPanel(parent, wxID_ANY);
-	chessboardPanel->SetBackgroundColour(resources.getColor("border"));
+wxPanel *Frame::createChessboard(wxWindow *parent, const EngineConfig &engineConfig) {
+	auto *panel = new wxPanel(parent, wxID_ANY);
 
 	grid = new ChessboardGrid();
 	if (!grid->Create(std::bind(&Frame::getBitmap, this, std::placeholders::_1, std::placeholders::_2),
 					  std::bind(&Frame::getColor, this, std::placeholders::_1, std::placeholders::_2),
-					  chessboardPanel, wxID_ANY, wxPoint(CHESSBOARD_BORDER_H, CHESSBOARD_BORDER_V))) {
+					  panel, wxID_ANY, wxDefaultPosition, engineConfig)) {
 #ifdef DEBUG
 		std::cerr << "Cannot create ChessboardGrid" << std::endl;
 #endif
 		return nullptr;
 	}
 
-	chessboardPanel->SetInitialSize(grid->GetSize() + wxSize(CHESSBOARD_BORDER_H * 2, CHESSBOARD_BORDER_V * 2));
+	// the grid fills the panel except the border
+	auto *rowSizer = new wxBoxSizer(wxHORIZONTAL);
+	rowSizer->AddSpacer(CHESSBOARD_BORDER_H);
+	rowSizer->Add(grid, 1, wxEXPAND);
+	rowSizer->AddSpacer(CHESSBOARD_BORDER_H);
+
+	auto *panelSizer = new wxBoxSizer(wxVERTICAL);
+	panelSizer->AddSpacer(CHESSBOARD_BORDER_V);
+	panelSizer->Add(rowSizer, 1, wxEXPAND);
+	panelSizer->AddSpacer(CHESSBOARD_BORDER_V);
+	panel->SetSizer(panelSizer);
+
+	return panel;
+}
+
+void Frame::applyColors() {
+	const wxColour &bgColor = resources.getColor("bg");
+	const wxColour &fgColor = resources.getColor("fg");
+
+	// Status Bar
+	wxStatusBar *statusBar = wxFrame::GetStatusBar();
+	statusBar->SetBackgroundColour(bgColor);
+	statusBar->SetForegroundColour(fgColor);
 
-	return chessboardPanel;
+	// Window theme
+	wxWindow::SetBackgroundColour(bgColor);
+	wxWindow::SetForegroundColour(fgColor);
+	chessboardPanel->SetBackgroundColour(resources.getColor("border"));
+	grid->SetBackgroundColour(resources.getColor("border"));
+}
+
+void Frame::applyTheme() {
+	applyColors();
+	if (!grid->reloadTheme(std::bind(&Frame::getBitmap, this, std::placeholders::_1, std::placeholders::_2),
+	                       std::bind(&Frame::getColor, this, std::placeholders::_1, std::placeholders::_2))) {
+#ifdef DEBUG
+		std::cerr << "Invalid theme bitmaps, the previous ones are kept" << std::endl;
+#endif
+	}
+
+	Refresh();
+}
+
+void Frame::watchTheme() {
+	if (!themeWatcher.start(resources.getThemeDirectories(),
+	                        std::bind(&Frame::onThemeFilesChanged, this, std::placeholders::_1))) {
+#ifdef DEBUG
+		std::cerr << "Cannot watch the theme files" << std::endl;
+#endif
+	}
+}
+
+void Frame::onThemeFilesChanged(const std::vector<std::string> &files) {
+	// shared, so the images are never copied between threads
+	auto images = std::make_shared<Resources::ImageMap>(Resources::decodeImages(files));
+
+	CallAfter([this, images] {
+		resources.reload(*images);
+		applyTheme();
+	});
 }
 
 const wxBitmap &Frame::getBitmap(const std::string &key, const wxBitmap &def) {
@@ -153,6 +214,10 @@ void Frame::onGameEvent(MatchManager::State state) {
 			SetStatusText(_("PC won"));
 			wxMessageDialog(this, _("You lost"), _("Game over")).ShowModal();
 			break;
+		case MatchManager::DRAW:
+			SetStatusText(_("Draw"));
+			wxMessageDialog(this, _("Draw by repetition or without progress"), _("Game over")).ShowModal();
+			break;
 		case MatchManager::ILLEGAL_SELECTION:
 			wxMessageDialog(this, _("You can't make any moves with this piece"), _("Invalid selection")).ShowModal();
 			break;
@@ -174,6 +239,34 @@ void Frame::closeFrame(wxCommandEvent &) {
 	Close();
 }
 
+void Frame::undoClicked(wxCommandEvent &) {
+	grid->undo();
+}
+
+void Frame::redoClicked(wxCommandEvent &) {
+	grid->redo();
+}
+
+void Frame::goToPlyClicked(wxCommandEvent &) {
+	long last = static_cast<long>(grid->getPlyCount()) - 1;
+	if (last < 0) return;
+
+	while (true) {
+		wxString message = wxString::Format(_("Choose the move from 0 (initial position) to %ld"), last);
+		wxTextEntryDialog dialog(this, message, _("Go to move"));
+		if (dialog.ShowModal() != wxID_OK) return;
+
+		long value;
+		if (dialog.GetValue().ToLong(&value) && value >= 0 && value <= last && grid->goToPly(value))
+			return;
+	}
+}
+
+void Frame::hintClicked(wxCommandEvent &) {
+	if (!grid->showHint())
+		SetStatusText(_("No hint yet, try again in a moment"));
+}
+
 void Frame::changeDifficultyClicked(wxCommandEvent &) {
 	if (grid->isPlaying()) {
 		wxMessageDialog dialog(this, _("Are you sure you want to leave the game?"), _("New match"), wxYES_NO);
@@ -203,6 +296,22 @@ void Frame::flipFirstPlayer(wxCommandEvent &) {
 	grid->newMatch(mGameDifficulty, mIsPcFirstPlayer = !mIsPcFirstPlayer);
 }
 
+void Frame::changeThemeClicked(wxCommandEvent &) {
+	wxArrayString themes;
+	for (const auto &theme: resources.getThemes())
+		themes.Add(theme);
+
+	wxSingleChoiceDialog dialog(this, _("Choose the theme"), _("Theme"), themes);
+	int current = themes.Index(resources.getTheme());
+	if (current != wxNOT_FOUND)
+		dialog.SetSelection(current);
+	if (dialog.ShowModal() != wxID_OK) return;
+
+	resources.setTheme(dialog.GetStringSelection().ToStdString());
+	applyTheme();
+	watchTheme();
+}
+
 void Frame::aboutClicked(wxCommandEvent &) {
 	wxAboutDialogInfo dialog;
 	dialog.SetName(wxFrame::GetTitle());
@@ -19,6 +19,7 @@
 #define FRAME_H
 
 #include "Resources/Resources.h"
+#include "Resources/ThemeWatcher.h"
 #include "ChessboardGrid/ChessboardGrid.h"
 
 #define CHESSBOARD_BORDER_H 40
@@ -34,10 +35,11 @@ public:
 	 * Creates a new Frame
 	 * @param parent Parent
 	 * @param theme Theme name (optional)
+	 * @param engineConfig Configuration of the PC's engine
 	 */
-	explicit Frame(wxWindow *parent, const std::string &theme = "");
+	explicit Frame(wxWindow *parent, const std::string &theme = "", const EngineConfig &engineConfig = EngineConfig());
 
-	bool Create(wxWindow *parent, const std::string &theme = "");
+	bool Create(wxWindow *parent, const std::string &theme = "", const EngineConfig &engineConfig = EngineConfig());
 
 private:
 	Frame(const Frame &); // prevents copy-constructor
@@ -46,9 +48,14 @@ private:
 		NEW_MATCH = 1,
 		CHANGE_GD,
 		TOGGLE_FIRST_PLAYER,
+		CHANGE_THEME,
+		GO_TO_PLY,
+		SHOW_HINT,
 	};
 
 	Resources resources;
+	ThemeWatcher themeWatcher;
+	wxPanel *chessboardPanel;
 	const wxArrayString developers = wxArrayString(1, {"Nicola Revelant <nicolarevelant44@gmail.com>"});
 	ChessboardGrid *grid;
 	int mGameDifficulty;
@@ -63,9 +70,31 @@ private:
 	/**
 	 * Creates a wxPanel that contains the ChessboardGrid
 	 * @param parent Parent
+	 * @param engineConfig Configuration of the PC's engine
 	 * @return The new wxPanel
 	 */
-	wxPanel *createChessboard(wxWindow *parent);
+	wxPanel *createChessboard(wxWindow *parent, const EngineConfig &engineConfig);
+
+	/**
+	 * Applies the colors of the current theme to the window
+	 */
+	void applyColors();
+
+	/**
+	 * Applies the colors of the current theme and reloads the chessboard's bitmaps
+	 */
+	void applyTheme();
+
+	/**
+	 * Watches the files of the current theme, changes are applied while the program is running
+	 */
+	void watchTheme();
+
+	/**
+	 * Called from the theme watcher's thread, decodes the changed images and applies them in the UI thread
+	 * @param files Changed files
+	 */
+	void onThemeFilesChanged(const std::vector<std::string> &files);
 
 	const wxBitmap &getBitmap(const std::string &key, const wxBitmap &def);
 
@@ -89,6 +118,26 @@ private:
 	 */
 	void closeFrame(wxCommandEvent &);
 
+	/**
+	 * Takes back the last move
+	 */
+	void undoClicked(wxCommandEvent &);
+
+	/**
+	 * Makes again the move taken back
+	 */
+	void redoClicked(wxCommandEvent &);
+
+	/**
+	 * Goes to a ply of the match
+	 */
+	void goToPlyClicked(wxCommandEvent &);
+
+	/**
+	 * Shows the move suggested to the player
+	 */
+	void hintClicked(wxCommandEvent &);
+
 	/**
 	 * Change difficulty
 	 */
@@ -99,6 +148,11 @@ private:
 	 */
 	void flipFirstPlayer(wxCommandEvent &);
 
+	/**
+	 * Change theme
+	 */
+	void changeThemeClicked(wxCommandEvent &);
+
 	/**
 	 * Shows about dialog
 	 */
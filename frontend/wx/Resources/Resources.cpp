@@ -2,35 +2,157 @@
 // Copyright (C) 2023  Nicola Revelant
 
 #include "Resources.h"
+#include <atomic>
+#include <unistd.h>
+#include <wx/image.h>
 
-Resources::Resources(const std::string &path) {
-	fillColorMap(mColors, path);
-	fillBitmapMap(mBitmaps, path);
+/**
+ * Header of a bitmap cache file, followed by the image path, the RGB data and the alpha channel
+ */
+struct CacheHeader {
+	char magic[4];
+	uint32_t version;
+	int64_t mtime; // modification time of the PNG file
+	uint64_t size; // size of the PNG file
+	uint32_t width, height, hasAlpha, pathLength;
+};
+
+Resources::Resources(const std::string &path) : mPath(path), mThemes{"default"} {
+	// bitmaps are decoded by wxImage in background threads
+	if (!wxImage::FindHandler(wxBITMAP_TYPE_PNG))
+		wxImage::AddHandler(new wxPNGHandler);
+
+	loadColors(mThemes[0]);
+	loadBitmaps(mThemes[0]);
 }
 
-void Resources::addTheme(const std::string &path, const std::string &theme) {
-	fillColorMap(mColors, path, theme);
-	fillBitmapMap(mBitmaps, path, theme);
+void Resources::addTheme(const std::string &theme) {
+	mThemes.push_back(theme);
+	loadColors(theme);
+	loadBitmaps(theme);
 }
 
-const wxColour &Resources::getColor(const std::string &key, const wxColour &def) const {
-	try {
-		return mColors.at(key);
-	} catch (std::out_of_range &) {
-		return def;
+void Resources::setTheme(const std::string &theme) {
+	mThemes.resize(1);
+	if (!theme.empty() && theme != mThemes[0])
+		mThemes.push_back(theme);
+	reload();
+}
+
+void Resources::reload(const ImageMap &images) {
+	// the IDs are kept, resources that are no longer defined fall back to the default value
+	std::fill(mColors.begin(), mColors.end(), wxColour());
+	std::vector<BitmapEntry> previous(mBitmaps.size());
+	previous.swap(mBitmaps);
+
+	for (const auto &theme: mThemes) {
+		loadColors(theme);
+		loadBitmaps(theme);
+	}
+
+	for (size_t i = 0; i < mBitmaps.size(); i++) {
+		BitmapEntry &entry = mBitmaps[i];
+		auto it = images.find(entry.path);
+		if (entry.path.empty()) {
+			entry.isLoaded = true;
+		} else if (it != images.end()) {
+			// decoded in background, only the bitmap is created here
+			entry.bitmap = it->second.IsOk() ? wxBitmap(it->second) : wxNullBitmap;
+			entry.isLoaded = true;
+		} else if (i < previous.size() && previous[i].path == entry.path) {
+			entry = std::move(previous[i]);
+		}
+	}
+}
+
+const std::string &Resources::getTheme() const {
+	return mThemes.back();
+}
+
+std::vector<std::string> Resources::getThemes() const {
+	std::set<std::string> themes;
+	std::error_code error;
+
+	for (const auto &file: std::filesystem::directory_iterator(mPath + "/colors", error))
+		if (file.is_regular_file(error)) themes.insert(file.path().filename().string());
+	for (const auto &directory: std::filesystem::directory_iterator(mPath + "/images", error))
+		if (directory.is_directory(error)) themes.insert(directory.path().filename().string());
+
+	return {themes.begin(), themes.end()};
+}
+
+std::vector<std::string> Resources::getThemeDirectories() const {
+	std::vector<std::string> directories{mPath + "/colors"};
+	for (const auto &theme: mThemes)
+		directories.push_back(mPath + "/images/" + theme);
+	return directories;
+}
+
+Resources::ImageMap Resources::decodeImages(const std::vector<std::string> &paths) {
+	std::vector<std::pair<std::string, std::future<wxImage>>> pending;
+	for (const auto &path: paths) {
+		if (std::filesystem::path(path).extension() == ".png")
+			pending.emplace_back(path, std::async(std::launch::async, loadImage, path));
 	}
+
+	ImageMap images;
+	for (auto &[path, image]: pending)
+		images[path] = image.get();
+	return images;
+}
+
+Resources::ResourceId Resources::findColor(const std::string &key) const {
+	auto it = mColorIds.find(key);
+	return it == mColorIds.end() ? NO_RESOURCE : it->second;
+}
+
+Resources::ResourceId Resources::findBitmap(const std::string &key) const {
+	auto it = mBitmapIds.find(key);
+	return it == mBitmapIds.end() ? NO_RESOURCE : it->second;
+}
+
+const wxColour &Resources::getColor(ResourceId id, const wxColour &def) const {
+	if (id < 0 || static_cast<size_t>(id) >= mColors.size()) return def;
+	return mColors[id].IsOk() ? mColors[id] : def;
+}
+
+const wxColour &Resources::getColor(const std::string &key, const wxColour &def) const {
+	return getColor(findColor(key), def);
 }
 
 const wxBitmap &Resources::getBitmap(const std::string &key, const wxBitmap &def) const {
-	try {
-		return mBitmaps.at(key);
-	} catch (std::out_of_range &) {
-		return def;
+	return getBitmap(findBitmap(key), def);
+}
+
+const wxBitmap &Resources::getBitmap(ResourceId id, const wxBitmap &def) const {
+	if (id < 0 || static_cast<size_t>(id) >= mBitmaps.size()) return def;
+
+	BitmapEntry &entry = mBitmaps[id];
+	if (!entry.isLoaded) {
+		startDecoding();
+
+		// wxBitmap must be created in the main thread
+		wxImage image = entry.image.get();
+		if (image.IsOk())
+			entry.bitmap = wxBitmap(image);
+		entry.image = {};
+		entry.isLoaded = true;
 	}
+
+	return entry.bitmap.IsOk() ? entry.bitmap : def;
+}
+
+template<typename T>
+Resources::ResourceId Resources::intern(std::unordered_map<std::string, ResourceId> &ids, std::vector<T> &values,
+                                        const std::string &key) {
+	auto [it, inserted] = ids.try_emplace(key, static_cast<ResourceId>(values.size()));
+	if (inserted)
+		values.emplace_back();
+	return it->second;
 }
 
-bool Resources::fillColorMap(ColorMap &colors, const std::string &path, const std::string &theme) {
-	std::string themePath = path;
+bool Resources::loadColors(const std::string &theme) {
+	std::string themePath = mPath;
 	themePath += "/colors/";
 	themePath += theme;
 
@@ -45,7 +167,7 @@ bool Resources::fillColorMap(ColorMap &colors, const std::string &path, const st
 
 			auto key = line.substr(0, delimPos);
 			auto value = line.substr(delimPos + 1);
-			colors[key] = wxColour(value.c_str());
+			mColors[intern(mColorIds, mColors, key)] = wxColour(value.c_str());
 		}
 
 		file.close();
@@ -55,8 +177,8 @@ bool Resources::fillColorMap(ColorMap &colors, const std::string &path, const st
 	return false;
 }
 
-bool Resources::fillBitmapMap(BitmapMap &bitmaps, const std::string &path, const std::string &theme) {
-	std::string themePath = path;
+bool Resources::loadBitmaps(const std::string &theme) {
+	std::string themePath = mPath;
 	themePath += "/images/";
 	themePath += theme;
 
@@ -68,14 +190,124 @@ bool Resources::fillBitmapMap(BitmapMap &bitmaps, const std::string &path, const
 		while (std::getline(indexFile, line)) {
 			if (line.empty() || line[0] == '#') continue;
 
-			// add "line.png" bitmap
+			// add "line.png" bitmap, it is decoded when requested
 			std::string imagePath = themePath;
 			imagePath += line;
 			imagePath += ".png";
 
-			bitmaps[line] = wxBitmap(imagePath);
+			mBitmaps[intern(mBitmapIds, mBitmaps, line)] = BitmapEntry{imagePath, {}, wxNullBitmap, false};
 		}
 	}
 
 	return false;
 }
+
+void Resources::startDecoding() const {
+	for (auto &entry: mBitmaps) {
+		if (!entry.isLoaded && !entry.image.valid())
+			entry.image = std::async(std::launch::async, loadImage, entry.path).share();
+	}
+}
+
+wxImage Resources::loadImage(const std::string &imagePath) {
+	std::error_code error;
+	int64_t mtime = std::filesystem::last_write_time(imagePath, error).time_since_epoch().count();
+	if (error) return {};
+	uint64_t size = std::filesystem::file_size(imagePath, error);
+	if (error) return {};
+
+	std::filesystem::path cachePath = getCachePath(imagePath);
+	if (!cachePath.empty()) {
+		wxImage image = readCache(cachePath, imagePath, mtime, size);
+		if (image.IsOk()) return image;
+	}
+
+	wxImage image(imagePath, wxBITMAP_TYPE_PNG);
+	if (image.IsOk() && !cachePath.empty())
+		writeCache(cachePath, imagePath, mtime, size, image);
+
+	return image;
+}
+
+std::filesystem::path Resources::getCachePath(const std::string &imagePath) {
+	std::filesystem::path cacheDir;
+	const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+	const char *home = std::getenv("HOME");
+	if (cacheHome && *cacheHome)
+		cacheDir = cacheHome;
+	else if (home && *home)
+		cacheDir = std::filesystem::path(home) / ".cache";
+	else
+		return {};
+
+	std::ostringstream name;
+	name << std::hex << std::hash<std::string>{}(imagePath) << ".bin";
+	return cacheDir / BITMAP_CACHE_DIR / name.str();
+}
+
+wxImage Resources::readCache(const std::filesystem::path &cachePath, const std::string &imagePath,
+                             int64_t mtime, uint64_t size) {
+	std::ifstream file(cachePath, std::ios::binary);
+	if (!file.is_open()) return {};
+
+	CacheHeader header{};
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) return {};
+	if (std::memcmp(header.magic, "IDBC", 4) != 0 || header.version != BITMAP_CACHE_VERSION ||
+	    header.mtime != mtime || header.size != size || header.width == 0 || header.height == 0 ||
+	    header.pathLength != imagePath.size())
+		return {}; // stale or foreign cache file
+
+	std::string path(header.pathLength, '\0');
+	if (!file.read(path.data(), header.pathLength) || path != imagePath) return {};
+
+	// wxImage takes ownership of memory allocated with malloc
+	size_t pixels = static_cast<size_t>(header.width) * header.height;
+	auto *data = static_cast<unsigned char *>(std::malloc(pixels * 3));
+	auto *alpha = header.hasAlpha ? static_cast<unsigned char *>(std::malloc(pixels)) : nullptr;
+	if (!data || (header.hasAlpha && !alpha) ||
+	    !file.read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(pixels * 3)) ||
+	    (alpha && !file.read(reinterpret_cast<char *>(alpha), static_cast<std::streamsize>(pixels)))) {
+		std::free(data);
+		std::free(alpha);
+		return {};
+	}
+
+	return wxImage(static_cast<int>(header.width), static_cast<int>(header.height), data, alpha);
+}
+
+void Resources::writeCache(const std::filesystem::path &cachePath, const std::string &imagePath,
+                           int64_t mtime, uint64_t size, const wxImage &image) {
+	std::error_code error;
+	std::filesystem::create_directories(cachePath.parent_path(), error);
+	if (error) return;
+
+	CacheHeader header{{'I', 'D', 'B', 'C'}, BITMAP_CACHE_VERSION, mtime, size,
+	                   static_cast<uint32_t>(image.GetWidth()), static_cast<uint32_t>(image.GetHeight()),
+	                   image.HasAlpha(), static_cast<uint32_t>(imagePath.size())};
+	size_t pixels = static_cast<size_t>(header.width) * header.height;
+
+	// written to a temporary file and renamed, so readers never see a partial file; the name is unique among
+	// the processes and the loading threads
+	static std::atomic<unsigned> tmpCounter{0};
+	std::filesystem::path tmpPath = cachePath;
+	tmpPath += "." + std::to_string(getpid()) + "." + std::to_string(tmpCounter++) + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return;
+
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		file.write(imagePath.data(), static_cast<std::streamsize>(imagePath.size()));
+		file.write(reinterpret_cast<const char *>(image.GetData()), static_cast<std::streamsize>(pixels * 3));
+		if (image.HasAlpha())
+			file.write(reinterpret_cast<const char *>(image.GetAlpha()), static_cast<std::streamsize>(pixels));
+		if (!file) {
+			file.close();
+			std::filesystem::remove(tmpPath, error);
+			return;
+		}
+	}
+
+	std::filesystem::rename(tmpPath, cachePath, error);
+	if (error)
+		std::filesystem::remove(tmpPath, error);
+}
@@ -7,10 +7,31 @@
 #include "wx/wx.h"
 #include <bits/stdc++.h>
 
+// version of the bitmap cache files, change it when the format changes
+#define BITMAP_CACHE_VERSION 1
+
+// directory of the bitmap cache, relative to $XDG_CACHE_HOME
+#define BITMAP_CACHE_DIR "italian-draughts/bitmaps"
+
 class Resources {
 public:
-	typedef std::map<std::string, wxColour> ColorMap;
-	typedef std::map<std::string, wxBitmap> BitmapMap;
+	/**
+	 * A bitmap is decoded the first time it is requested
+	 */
+	struct BitmapEntry {
+		std::string path; // PNG file, empty if no theme defines the bitmap
+		std::shared_future<wxImage> image; // valid while decoding
+		wxBitmap bitmap;
+		bool isLoaded = false;
+	};
+
+	typedef std::map<std::string, wxImage> ImageMap; // decoded images by PNG file
+
+	/**
+	 * Index of a resource, keys are resolved once when the theme is loaded
+	 */
+	typedef int ResourceId;
+	static const ResourceId NO_RESOURCE = -1;
 
 	/**
 	 * Initialize a new object with the default theme
@@ -20,23 +41,106 @@ public:
 
 	/**
 	 * Adds or overwrites colors read from a file that represents the specified theme
-	 * @param path Resource path
 	 * @param theme Theme to add
 	 */
-	void addTheme(const std::string &path, const std::string &theme);
+	void addTheme(const std::string &theme);
+
+	/**
+	 * Replaces the added themes with the specified one, the IDs of the resources do not change
+	 * @param theme Theme to use over the default one
+	 */
+	void setTheme(const std::string &theme);
+
+	/**
+	 * Reads again the theme files, bitmaps whose file did not change are kept
+	 * @param images Images decoded again because their file changed
+	 */
+	void reload(const ImageMap &images = {});
+
+	/**
+	 * @return The last added theme
+	 */
+	const std::string &getTheme() const;
+
+	/**
+	 * @return The themes available in the resource path
+	 */
+	std::vector<std::string> getThemes() const;
+
+	/**
+	 * @return The directories that contain the files of the current themes
+	 */
+	std::vector<std::string> getThemeDirectories() const;
+
+	/**
+	 * Decodes in parallel the PNG files, other files are ignored.
+	 * It can be called from any thread
+	 */
+	static ImageMap decodeImages(const std::vector<std::string> &paths);
+
+	/**
+	 * @return The ID of the color, or NO_RESOURCE if no theme defines it
+	 */
+	ResourceId findColor(const std::string &key) const;
+
+	/**
+	 * @return The ID of the bitmap, or NO_RESOURCE if no theme defines it
+	 */
+	ResourceId findBitmap(const std::string &key) const;
+
+	const wxColour &getColor(ResourceId id, const wxColour &def = wxNullColour) const;
 
 	const wxColour &getColor(const std::string &key, const wxColour &def = wxNullColour) const;
 
+	/**
+	 * The first call decodes in parallel every bitmap not loaded yet, then waits only for the requested one
+	 */
+	const wxBitmap &getBitmap(ResourceId id, const wxBitmap &def = wxNullBitmap) const;
+
 	const wxBitmap &getBitmap(const std::string &key, const wxBitmap &def = wxNullBitmap) const;
 
 private:
 	Resources(const Resources &); // prevents copy-constructor
-	ColorMap mColors;
-	BitmapMap mBitmaps;
+	std::string mPath;
+	std::vector<std::string> mThemes;
+	std::unordered_map<std::string, ResourceId> mColorIds, mBitmapIds;
+	std::vector<wxColour> mColors;
+	mutable std::vector<BitmapEntry> mBitmaps;
+
+	bool loadColors(const std::string &theme);
+
+	bool loadBitmaps(const std::string &theme);
+
+	/**
+	 * @return The ID of the key, a new resource is appended to values if the key is new
+	 */
+	template<typename T>
+	static ResourceId intern(std::unordered_map<std::string, ResourceId> &ids, std::vector<T> &values,
+	                         const std::string &key);
+
+	/**
+	 * Starts decoding the bitmaps that are not loaded yet in background
+	 */
+	void startDecoding() const;
+
+	/**
+	 * Decodes a PNG file, or reads it from the bitmap cache if the file did not change.
+	 * It can be called from any thread
+	 * @param imagePath PNG file
+	 * @return The decoded image, or an invalid image
+	 */
+	static wxImage loadImage(const std::string &imagePath);
+
+	/**
+	 * @return The file of the bitmap cache of the specified image
+	 */
+	static std::filesystem::path getCachePath(const std::string &imagePath);
 
-	static bool fillColorMap(ColorMap &colors, const std::string &path, const std::string &theme = "default");
+	static wxImage readCache(const std::filesystem::path &cachePath, const std::string &imagePath,
+	                         int64_t mtime, uint64_t size);
 
-	static bool fillBitmapMap(BitmapMap &bitmaps, const std::string &path, const std::string &theme = "default");
+	static void writeCache(const std::filesystem::path &cachePath, const std::string &imagePath,
+	                       int64_t mtime, uint64_t size, const wxImage &image);
 };
 
 
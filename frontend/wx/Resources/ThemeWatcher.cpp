@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2023  Nicola Revelant
+
+#include "ThemeWatcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <set>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ThemeWatcher::~ThemeWatcher() {
+	stop();
+}
+
+bool ThemeWatcher::start(const std::vector<std::string> &directories, const ChangeCB &onChange) {
+	stop();
+
+#ifdef __linux__
+	mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	mStopFd = eventfd(0, EFD_CLOEXEC);
+	if (mInotifyFd < 0 || mStopFd < 0) {
+		stop();
+		return false;
+	}
+
+	// files are replaced by editors and tools, so renames are reported too
+	std::vector<std::pair<int, std::string>> watches;
+	for (const auto &directory: directories) {
+		int wd = inotify_add_watch(mInotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+		if (wd >= 0)
+			watches.emplace_back(wd, directory);
+	}
+
+	if (watches.empty()) {
+		stop();
+		return false;
+	}
+
+	mThread = std::thread(&ThemeWatcher::run, this, std::move(watches), onChange);
+	return true;
+#else
+	(void) directories;
+	(void) onChange;
+	return false;
+#endif
+}
+
+void ThemeWatcher::stop() {
+#ifdef __linux__
+	if (mThread.joinable()) {
+		// the eventfd is blocking, so the write fails only if interrupted; the thread polls the fds until it
+		// returns, they are closed after that
+		uint64_t value = 1;
+		while (write(mStopFd, &value, sizeof(value)) < 0 && errno == EINTR);
+		mThread.join();
+	}
+
+	if (mInotifyFd >= 0) close(mInotifyFd);
+	if (mStopFd >= 0) close(mStopFd);
+	mInotifyFd = mStopFd = -1;
+#endif
+}
+
+void ThemeWatcher::run(std::vector<std::pair<int, std::string>> watches, ChangeCB onChange) const {
+#ifdef __linux__
+	std::set<std::string> changed;
+	alignas(inotify_event) char buffer[4096];
+	pollfd fds[2] = {{mInotifyFd, POLLIN, 0}, {mStopFd, POLLIN, 0}};
+
+	while (true) {
+		int ready = poll(fds, 2, changed.empty() ? -1 : WATCH_DEBOUNCE_MS);
+		if (ready < 0) {
+			if (errno == EINTR) continue;
+			return;
+		}
+
+		if (fds[1].revents) return;
+
+		if (ready == 0) {
+			// no other changes, report them all at once
+			onChange(std::vector<std::string>(changed.begin(), changed.end()));
+			changed.clear();
+			continue;
+		}
+
+		ssize_t length;
+		while ((length = read(mInotifyFd, buffer, sizeof(buffer))) > 0) {
+			for (char *ptr = buffer; ptr < buffer + length;) {
+				auto *event = reinterpret_cast<inotify_event *>(ptr);
+				auto it = std::find_if(watches.begin(), watches.end(), [event](const auto &watch) {
+					return watch.first == event->wd;
+				});
+				if (event->len && it != watches.end())
+					changed.insert(it->second + "/" + event->name);
+				ptr += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+#else
+	(void) watches;
+	(void) onChange;
+#endif
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2023  Nicola Revelant
+
+#ifndef THEME_WATCHER_H
+#define THEME_WATCHER_H
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// time to wait for other changes after the first one, editors save a file with several writes
+#define WATCH_DEBOUNCE_MS 100
+
+/**
+ * Watches the theme directories and reports the files that changed.
+ * It uses inotify, so it is available only on Linux
+ */
+class ThemeWatcher {
+public:
+	/**
+	 * Called from the watcher thread with the changed files
+	 */
+	typedef std::function<void(const std::vector<std::string> &files)> ChangeCB;
+
+	ThemeWatcher() = default;
+
+	~ThemeWatcher();
+
+	/**
+	 * Starts watching the directories, a previous watch is stopped
+	 * @param directories Directories to watch, the ones that do not exist are ignored
+	 * @param onChange Called from the watcher thread when some files changed
+	 * @return False if watching is not supported or no directory can be watched
+	 */
+	bool start(const std::vector<std::string> &directories, const ChangeCB &onChange);
+
+	/**
+	 * Stops watching and waits for the watcher thread
+	 */
+	void stop();
+
+private:
+	ThemeWatcher(const ThemeWatcher &); // prevents copy-constructor
+	std::thread mThread;
+	int mInotifyFd = -1, mStopFd = -1;
+
+	void run(std::vector<std::pair<int, std::string>> watches, ChangeCB onChange) const;
+};
+
+
+#endif // THEME_WATCHER_H
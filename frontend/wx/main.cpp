@@ -22,6 +22,8 @@
 static option longOptions[] = {
 		{"locale", required_argument, nullptr, 'l'},
 		{"theme",  required_argument, nullptr, 't'},
+		{"network", required_argument, nullptr, 'n'},
+		{"weights", required_argument, nullptr, 'w'},
 		{"help",   no_argument,       nullptr, 'h'}
 };
 
@@ -31,8 +33,9 @@ public:
 		wxLog::SetActiveTarget(new wxLogStderr);
 		char *locale = nullptr;
 		std::string theme;
+		EngineConfig engineConfig;
 		int c;
-		while ((c = getopt_long(argc, argv, ":l:t:h", longOptions, nullptr)) != -1) {
+		while ((c = getopt_long(argc, argv, ":l:t:n:w:h", longOptions, nullptr)) != -1) {
 			switch (c) {
 				case '?':
 					std::cout << "Unknown option: " << optind << std::endl;
@@ -45,6 +48,14 @@ public:
 					// theme
 					theme = optarg;
 					break;
+				case 'n':
+					// evaluation network
+					engineConfig.networkFile = optarg;
+					break;
+				case 'w':
+					// weights of the evaluation
+					engineConfig.weightsFile = optarg;
+					break;
 				case 'h':
 					// help message
 					printHelpMessage();
@@ -59,7 +70,7 @@ public:
 			std::setlocale(LC_ALL, locale);
 
 		auto *frame = new Frame();
-		if (frame->Create(nullptr, theme)) {
+		if (frame->Create(nullptr, theme, engineConfig)) {
 			frame->Show(true);
 		} else {
 			frame->Destroy();
@@ -82,6 +93,8 @@ public:
 		std::cout << "Options:" << std::endl;
 		std::cout << "  -l, --locale=LOCALE        Use LOCALE as language" << std::endl;
 		std::cout << "  -t, --theme=THEME          Use THEME as theme name" << std::endl;
+		std::cout << "  -n, --network=FILE         Evaluate the positions with the network in FILE" << std::endl;
+		std::cout << "  -w, --weights=FILE         Use the evaluation weights in FILE" << std::endl;
 	}
 };
 
@@ -0,0 +1,182 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHECKERS_C_API_H
+#define CHECKERS_C_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * C interface of the engine, for programs that cannot use the C++ classes
+ *
+ * A chessboard is an array of 64 squares, index = row * 8 + column, each one with a checkers_piece.
+ * The engine plays the PC's pieces, the player's moves are searched on the flipped chessboard.
+ * Structures are initialized with their init function, so new fields can be added.
+ */
+
+enum checkers_piece {
+	CHECKERS_EMPTY = 0,
+	CHECKERS_PC_PAWN,
+	CHECKERS_PC_DAME,
+	CHECKERS_PLAYER_PAWN,
+	CHECKERS_PLAYER_DAME
+};
+
+typedef struct checkers_engine checkers_engine;
+
+/**
+ * Memory used by an engine, see EngineConfig
+ */
+typedef struct checkers_config {
+	size_t tt_size; /* bytes of the transposition table */
+	size_t arena_size; /* bytes of the moves of a search */
+	int selective_search; /* 0 to search all the moves at full depth */
+	const char *weights_file; /* NULL to use the default weights */
+	const char *network_file; /* NULL to use the piece-square tables */
+} checkers_config;
+
+/**
+ * When a search stops, see SearchLimits and TimeManager
+ */
+typedef struct checkers_limits {
+	int depth; /* maximum depth */
+	uint64_t nodes; /* the default is the budget of the strongest level; 0 if unlimited, the search then
+	                   ends only with a clock or checkers_engine_stop() */
+	long time; /* milliseconds left on the clock, 0 to search without a clock */
+	long increment; /* milliseconds added after each move */
+	int moves_to_go; /* moves until the next time control, 0 if the time is for the whole game */
+} checkers_limits;
+
+typedef struct checkers_move {
+	int from, to; /* position of the moved piece before and after the move */
+	uint8_t squares[64]; /* the chessboard after the move */
+	int score; /* of the search from the side that moves, a pawn is worth 100; INT_MAX if it wins */
+} checkers_move;
+
+/**
+ * Statistics of the last search, see EngineStats
+ */
+typedef struct checkers_stats {
+	uint64_t nodes;
+	int score; /* from the side that moved, a pawn is worth 100 */
+	int depth; /* of the last completed iteration, 0 if the move was forced */
+	size_t tt_size, arena_size, arena_peak; /* bytes */
+	size_t peak_rss; /* peak resident memory of the process in bytes, 0 if unknown */
+} checkers_stats;
+
+/**
+ * @return Version of the library, MAJOR.MINOR.PATCH
+ */
+const char *checkers_version(void);
+
+void checkers_config_init(checkers_config *config);
+
+/**
+ * Sets the default limits: a node budget like a PC's move at the strongest difficulty, no clock
+ */
+void checkers_limits_init(checkers_limits *limits);
+
+/**
+ * Creates an engine, the memory is allocated now
+ * @param config NULL to use the default configuration
+ * @return The engine, or NULL if it cannot be created
+ */
+checkers_engine *checkers_engine_create(const checkers_config *config);
+
+void checkers_engine_destroy(checkers_engine *engine);
+
+/**
+ * Forgets everything learned in the previous game and a pending stop (see checkers_engine_stop())
+ */
+void checkers_engine_new_game(checkers_engine *engine);
+
+/**
+ * Sets the positions played before the next searches, see Engine::setGameHistory()
+ * @param keys Keys (checkers_history_key()) of the positions since the last capture or pawn move, oldest
+ * first, for the side searched next
+ * @return 0, or -1 if the arguments are not valid or the memory is not enough
+ */
+int checkers_engine_set_history(checkers_engine *engine, const uint64_t *keys, size_t count);
+
+/**
+ * Searches the best move of the side that moves. The engine always searches the PC's move: the player's
+ * move is searched on the chessboard rotated by 180 degrees with the colors swapped
+ * @param squares Chessboard before the move
+ * @param player 0 to search the PC's move, 1 to search the player's move
+ * @param limits NULL to use the default limits (checkers_limits_init())
+ * @param move Best move
+ * @return 1 if the move is found, 0 if there are no moves, the search was stopped or the memory is not
+ * enough, -1 if the arguments are not valid
+ */
+int checkers_engine_search(checkers_engine *engine, const uint8_t squares[64], int player,
+                           const checkers_limits *limits, checkers_move *move);
+
+/**
+ * Searches the best moves of the side that moves with their exact score (MultiPV), see Engine::analyze()
+ * @param squares Chessboard before the move
+ * @param player 0 to search the PC's moves, 1 to search the player's moves
+ * @param limits NULL to use the default limits (checkers_limits_init())
+ * @param lines Array of capacity moves, best first
+ * @return Number of moves written, fewer than capacity if there are not enough moves or one of them wins;
+ * 0 if there are no moves, the search was stopped or the memory is not enough, -1 if the arguments are
+ * not valid
+ */
+int checkers_engine_analyze(checkers_engine *engine, const uint8_t squares[64], int player,
+                            const checkers_limits *limits, checkers_move *lines, size_t capacity);
+
+/**
+ * Aborts the search running in another thread, which returns 0. If no search is running the next search
+ * is aborted, unless checkers_engine_new_game() is called first
+ * This function is thread safe
+ */
+void checkers_engine_stop(checkers_engine *engine);
+
+void checkers_engine_get_stats(const checkers_engine *engine, checkers_stats *stats);
+
+/**
+ * Finds the legal moves of a side
+ * @param moves Array of capacity moves, the moves beyond the capacity are not written
+ * @return Number of legal moves, 0 if the chessboard is not valid or the memory is not enough
+ */
+size_t checkers_find_moves(const uint8_t squares[64], int player, checkers_move *moves, size_t capacity);
+
+/**
+ * Zobrist hash of a position, see GameUtils::hash()
+ * @param pc_turn 1 if the PC moves next
+ * @return The hash, 0 if the chessboard is not valid
+ */
+uint64_t checkers_hash(const uint8_t squares[64], int pc_turn);
+
+/**
+ * Key of a position of the game for checkers_engine_set_history(). The searches of the player see the
+ * chessboard flipped (see checkers_engine_search()), so their keys are not the checkers_hash() ones
+ * @param pc_turn 1 if the PC moves next
+ * @param player The side of the searches that use the key, 0 for the PC and 1 for the player
+ * @return The key, 0 if the chessboard is not valid
+ */
+uint64_t checkers_history_key(const uint8_t squares[64], int pc_turn, int player);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHECKERS_C_API_H */
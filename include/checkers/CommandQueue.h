@@ -0,0 +1,101 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+/**
+ * Unbounded lock-free queue with many producers and one consumer (Vyukov's algorithm)
+ *
+ * Any thread can push without waiting, only the consumer's thread can pop. The consumer can
+ * sleep until something is pushed.
+ */
+template<typename T>
+class CommandQueue {
+public:
+	CommandQueue() : mHead(new Node), mTail(mHead.load(std::memory_order_relaxed)) {}
+
+	~CommandQueue() {
+		while (mTail) {
+			Node *next = mTail->next.load(std::memory_order_relaxed);
+			delete mTail;
+			mTail = next;
+		}
+	}
+
+	/**
+	 * Adds a value at the end of the queue and wakes up the consumer
+	 * This method is thread safe
+	 */
+	void push(T value) {
+		Node *node = new Node;
+		node->value = std::move(value);
+
+		// the node is reachable by the consumer only after the previous one is linked to it
+		Node *previous = mHead.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+
+		mSignal.fetch_add(1, std::memory_order_release);
+		mSignal.notify_one();
+	}
+
+	/**
+	 * Removes the first value, only from the consumer's thread
+	 * @return False if the queue is empty
+	 */
+	bool pop(T &value) {
+		Node *next = mTail->next.load(std::memory_order_acquire);
+		if (!next) return false;
+
+		// the first node is a placeholder, the next one becomes the placeholder
+		value = std::move(next->value);
+		delete mTail;
+		mTail = next;
+		return true;
+	}
+
+	/**
+	 * Removes the first value, waiting for it if the queue is empty, only from the consumer's thread
+	 */
+	void waitPop(T &value) {
+		while (true) {
+			uint32_t signal = mSignal.load(std::memory_order_acquire);
+			if (pop(value)) return;
+
+			// a value pushed after the load changes the signal, so it is not missed
+			mSignal.wait(signal, std::memory_order_acquire);
+		}
+	}
+
+private:
+	CommandQueue(const CommandQueue &); // prevents copy-constructor
+
+	struct Node {
+		std::atomic<Node *> next = nullptr;
+		T value{};
+	};
+
+	std::atomic<Node *> mHead; // last pushed node, written by the producers
+	Node *mTail; // placeholder before the first value, used only by the consumer
+	std::atomic<uint32_t> mSignal = 0; // incremented by each push
+};
+
+#endif // COMMAND_QUEUE_H
@@ -0,0 +1,308 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "checkers/Evaluator.h"
+#include "checkers/GameUtils.h"
+#include "checkers/MoveArena.h"
+#include "checkers/TimeManager.h"
+#include "checkers/TranspositionTable.h"
+#include <array>
+#include <atomic>
+#include <random>
+#include <string>
+#include <vector>
+
+#define DEF_TT_SIZE (16 << 20) // bytes
+#define DEF_ARENA_SIZE (1 << 20) // bytes
+#define MAX_PLY 64
+#define MAX_DEPTH (MAX_PLY - 2)
+
+/**
+ * Memory, threads and search options of an engine, fixed when the engine is created
+ */
+struct EngineConfig {
+	size_t ttSize = DEF_TT_SIZE; // bytes of the transposition table
+	size_t arenaSize = DEF_ARENA_SIZE; // bytes of the moves of a search, for each thread
+	int threads = 1; // search threads, the search is single-threaded so only 1 is supported
+	bool interleaveTable = false; // spread the transposition table among the NUMA nodes, for engines used
+	                              // by threads on different nodes (only on Linux)
+	std::string weightsFile; // weights of the piece-square tables, empty to use the default ones
+	std::string networkFile; // weights of the evaluation network, empty to use the piece-square tables
+	bool selectiveSearch = true; // reduce and prune the quiet moves, false to search all the moves at full depth;
+	                             // searches of more candidates are never selective
+};
+
+/**
+ * Limits and weakening of a search, used by the difficulty levels
+ *
+ * The move is picked among the best candidates by their score plus a random noise, the scores of
+ * all the candidates are exact. A blunder is the best move of a search at depth 1.
+ */
+struct SearchLimits {
+	int depth = MAX_DEPTH; // maximum depth
+	uint64_t nodes = 0; // nodes of a move, the last completed iteration is used; 0 if unlimited
+	int candidates = 1; // best moves the PC can choose from
+	int noise = 0; // maximum random score added to each candidate
+	int blunderPercent = 0; // probability of a blunder
+};
+
+/**
+ * A move of the PC found by the last search with its principal variation
+ */
+struct SearchLine {
+	int from = -1, to = -1; // position of the moved piece before and after the move
+	GameUtils::Disposition disposition{}; // after the move
+	int score = 0; // from the PC's point of view with the material, INT_MAX if the PC wins
+	std::vector<std::pair<int, int>> pv; // from and to of each move, starting with this one
+};
+
+/**
+ * Statistics of the last search
+ */
+struct EngineStats {
+	uint64_t nodes = 0;
+	int score = 0; // of the best move from the PC's point of view with the material, INT_MAX if the PC wins
+	int depth = 0; // of the last completed iteration, 0 if the move was forced
+	Evaluator::Instructions evalInstructions = Evaluator::INSTRUCTIONS_SCALAR; // used by the leaf evaluation
+	bool network = false; // the leaves are evaluated by the network
+	size_t ttSize = 0; // bytes
+	TranspositionTable::Pages ttPages = TranspositionTable::PAGES_NORMAL;
+	bool ttInterleaved = false; // the table is spread among the NUMA nodes
+	size_t arenaSize = 0, arenaPeak = 0; // bytes, the peak is since the engine was created
+	size_t peakRss = 0; // peak resident memory of the process in bytes, 0 if unknown
+};
+
+/**
+ * This class calculates the PC's moves (Minimax algorithm with alpha-beta pruning)
+ *
+ * What is learned during a search (transposition table, principal variation and history of the
+ * moves that caused a cut-off) is kept for the next searches of the same game.
+ * The memory is allocated when the engine is created: the moves of a search live in an arena
+ * that is emptied at the beginning of the next one.
+ * Note: methods are not thread-safe
+ */
+class Engine {
+public:
+	/**
+	 * Follows the progress of a search, it is called by the thread of the search
+	 */
+	class SearchListener {
+		public:
+		/**
+		 * Called after each completed iteration
+		 * @param line The best move of the iteration
+		 * @param depth The depth of the iteration
+		 */
+		virtual void onIteration(const SearchLine &line, int depth) = 0;
+	};
+
+	/**
+	 * Creates a new engine
+	 * @param config Sizes of the memory used by the engine
+	 */
+	explicit Engine(const EngineConfig &config = EngineConfig());
+
+	/**
+	 * @return The configuration of the engine, with the values actually used
+	 */
+	const EngineConfig &getConfig() const;
+
+	/**
+	 * @return Statistics of the last search and of the memory used
+	 */
+	EngineStats getStats() const;
+
+	/**
+	 * Forgets everything learned in the previous game
+	 */
+	void newGame();
+
+	/**
+	 * Calculates the best move for the computer
+	 * @param disposition Current pieces' disposition
+	 * @param depth How many recursion levels are allowed
+	 * @param stop If not nullptr, the search is aborted as soon as it becomes true
+	 * @param timeManager If not nullptr, it decides when to stop deepening the search (depth is still the maximum)
+	 * @return A possible move for the computer (ownership: caller), or nullptr if there are no moves
+	 * or the search was stopped. A forced move (all the moves lead to the same disposition) is returned
+	 * without searching and marked as forced in the time manager.
+	 */
+	GameUtils::Move *calculateBestMove(const GameUtils::Disposition &disposition, int depth,
+	                                   const std::atomic<bool> *stop = nullptr, TimeManager *timeManager = nullptr);
+
+	/**
+	 * Calculates the PC's move within the specified limits, see the other overload
+	 * @param limits Budget of the search and how much the PC is weakened
+	 */
+	GameUtils::Move *calculateBestMove(const GameUtils::Disposition &disposition, const SearchLimits &limits,
+	                                   const std::atomic<bool> *stop = nullptr, TimeManager *timeManager = nullptr);
+
+	/**
+	 * Calculates the best moves for the computer with a single search (MultiPV): the moves share
+	 * the transposition table and the ordering, and only the moves that can be among the best ones
+	 * are searched with an open window. The moves are never reduced or pruned, see
+	 * EngineConfig::selectiveSearch
+	 * @param disposition Current pieces' disposition
+	 * @param lines How many moves
+	 * @param depth How many recursion levels are allowed
+	 * @param stop If not nullptr, the search is aborted as soon as it becomes true
+	 * @param timeManager If not nullptr, it decides when to stop deepening the search
+	 * @return The best moves with their exact score, best first, fewer if there are not enough moves or
+	 * a winning move is found; empty if the search was stopped before the first iteration. A forced move
+	 * is not searched, its score is the static evaluation
+	 */
+	std::vector<SearchLine> analyze(const GameUtils::Disposition &disposition, int lines, int depth,
+	                                const std::atomic<bool> *stop = nullptr, TimeManager *timeManager = nullptr);
+
+	/**
+	 * @return The moves of the last search, the best candidates of calculateBestMove() (see
+	 * SearchLimits::candidates) or the lines of analyze()
+	 */
+	const std::vector<SearchLine> &getLines() const;
+
+	/**
+	 * Sets the positions played before the next searches, a position of the search that repeats
+	 * one of them or one of the current path is scored as a draw
+	 * @param keys Hashes of the positions since the last capture or pawn move, oldest first
+	 */
+	void setGameHistory(const std::vector<uint64_t> &keys);
+
+	/**
+	 * The player's move expected after the last move calculated, taken from the principal variation
+	 * @param from Position of the moved piece before the move
+	 * @param to Position of the moved piece after the move
+	 * @return False if there is no prediction
+	 */
+	bool getPredictedReply(int &from, int &to) const;
+
+	/**
+	 * Sets the listener of the next searches
+	 * @param listener nullptr to remove it
+	 */
+	void setSearchListener(SearchListener *listener);
+
+private:
+	Engine(const Engine &); // prevents copy-constructor
+
+	struct MoveRef {
+		int8_t from, to;
+	};
+
+	/**
+	 * A root move with an exact score and its principal variation
+	 */
+	struct RootLine {
+		GameUtils::Move *move;
+		int score;
+		std::vector<MoveRef> pv;
+	};
+
+	EngineConfig mConfig;
+	TranspositionTable mTable;
+
+	/**
+	 * Moves found by the search below the root, and the list of them at each ply
+	 */
+	MoveArena mArena;
+	std::array<GameUtils::MoveList, MAX_PLY> mMoves;
+
+	/**
+	 * Evaluation of the leaves, updated at each ply. The moves of a node at depth 1 are evaluated together
+	 */
+	Evaluator mEvaluator;
+	std::vector<int> mLeafScores;
+
+	/**
+	 * Score of the quiet moves that caused a cut-off, for each side
+	 */
+	std::array<std::array<std::array<int, 64>, 64>, 2> mHistory{};
+
+	/**
+	 * Triangular table of the principal variation found at each ply
+	 */
+	std::array<std::array<MoveRef, MAX_PLY>, MAX_PLY> mPv{};
+	std::array<int, MAX_PLY> mPvLength{};
+
+	/**
+	 * Principal variation of the last completed search
+	 */
+	std::array<MoveRef, MAX_PLY> mLastPv{};
+	int mLastPvLength = 0;
+	int mLastScore = 0, mLastDepth = 0;
+	std::vector<SearchLine> mLastLines;
+
+	/**
+	 * Positions of the game before the root and positions of the current path, indexed by
+	 * mKeyBase + ply. At each ply only the positions from mRepetitionStart can be repeated
+	 */
+	std::vector<uint64_t> mGameKeys, mKeys;
+	std::array<int, MAX_PLY + 1> mRepetitionStart{};
+	int mKeyBase = 0;
+	int mDrawScore = 0; // score of a draw relative to the root's material
+
+	const std::atomic<bool> *mStop = nullptr;
+	TimeManager *mTimeManager = nullptr;
+	SearchListener *mListener = nullptr;
+	uint64_t mNodeLimit = 0; // 0 if unlimited
+	bool mOutOfBudget = false; // the time or the nodes of the search are over
+	bool mSelective = true; // reductions and pruning, only with a single candidate so the scores stay exact
+	uint64_t mNodes = 0, mNextBudgetCheck = 0;
+	std::mt19937 mRandom;
+
+	/**
+	 * Calculates the score of the best move
+	 * @param disposition The disposition to search
+	 * @param oldScore The current score
+	 * @param maximizing True if PC
+	 * @param depth How many levels of recursion to do
+	 * @param ply Distance from the root
+	 * @param alpha Used by alpha-beta pruning
+	 * @param beta Used by alpha-beta pruning
+	 * @return The score after the best move, or INT_MIN if maximizing, or INT_MAX otherwise
+	 */
+	int minimax(const GameUtils::Disposition &disposition, int oldScore, bool maximizing, int depth, int ply,
+	            int alpha, int beta);
+
+	/**
+	 * Sorts the moves to search first the best move of the table, then the captures and the promotions and then
+	 * the quiet moves with the best history
+	 */
+	void orderMoves(const GameUtils::Disposition &disposition, GameUtils::MoveList &moves, bool maximizing,
+	                int ttFrom, int ttTo) const;
+
+	/**
+	 * Sets the move as the first of the principal variation at the specified ply
+	 */
+	void updatePv(int ply, const GameUtils::Move *move);
+
+	/**
+	 * @return The line of a root move, with the material of the root added to the score
+	 */
+	static SearchLine toSearchLine(const RootLine &candidate, const GameUtils::Disposition &disposition);
+
+	/**
+	 * @return True if the position at the specified ply, already added to mKeys, is a repetition
+	 */
+	bool isRepetition(int ply) const;
+
+	bool isStopped() const;
+};
+
+#endif // ENGINE_H
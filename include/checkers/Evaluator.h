@@ -0,0 +1,171 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include "checkers/GameUtils.h"
+#include "checkers/Network.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Positional evaluation of a disposition with piece-square tables, from the PC's point of view.
+ * The material is not included: the search adds it from the scores of the moves. The tables
+ * can be loaded from a weights file (see tools/tuner).
+ *
+ * The frontier of the search evaluates all the moves of a node at once: each disposition is
+ * compared with the node's one using the widest vector instructions supported by the CPU
+ * (chosen when the evaluator is created) and only the changed squares are looked up.
+ *
+ * If a network is loaded, it replaces the tables. The search keeps the state of each ply
+ * (the table score or the network's accumulator) and updates it with each move, so taking
+ * a move back costs nothing
+ */
+class Evaluator {
+public:
+	enum Instructions {
+		INSTRUCTIONS_SCALAR = 0,
+		INSTRUCTIONS_SSE2,
+		INSTRUCTIONS_AVX2
+	};
+
+	/**
+	 * Bonus of the PC's pieces on each dark square (see GameHistory::unpack()), the player's
+	 * bonuses are the same with the chessboard rotated by 180 degrees
+	 *
+	 * File format: lines "pawn=" and "dame=" followed by 32 integers separated by spaces,
+	 * lines starting with '#' are comments
+	 */
+	struct Weights {
+		std::array<int32_t, 32> pawn, dame;
+	};
+
+	/**
+	 * Score of each kind of piece (indexed by GameUtils::PieceType) on each position
+	 */
+	typedef std::array<std::array<int32_t, 64>, 5> Tables;
+
+	/**
+	 * Creates an evaluator
+	 * @param plies Number of plies whose state is kept, from 0 to plies - 1
+	 * @param maximum The widest instructions that can be used, if the CPU supports them
+	 */
+	explicit Evaluator(int plies = 1, Instructions maximum = INSTRUCTIONS_AVX2);
+
+	/**
+	 * @return The weights built into the program
+	 */
+	static Weights getDefaultWeights();
+
+	/**
+	 * @return False if the file cannot be read or it is not valid
+	 */
+	static bool readWeights(const std::string &path, Weights &weights);
+
+	/**
+	 * @return False if the file cannot be written
+	 */
+	static bool writeWeights(const std::string &path, const Weights &weights);
+
+	/**
+	 * Replaces the weights of the piece-square tables with the ones in a file
+	 * @return False if the file cannot be read or it is not valid, the current weights are kept
+	 */
+	bool loadWeights(const std::string &path);
+
+	void setWeights(const Weights &weights);
+
+	const Weights &getWeights() const;
+
+	/**
+	 * Uses a network instead of the piece-square tables
+	 * @param path Path of the network's file
+	 * @return False if the network cannot be loaded, the current evaluation is kept
+	 */
+	bool loadNetwork(const std::string &path);
+
+	/**
+	 * @return True if the evaluation uses a network
+	 */
+	bool hasNetwork() const;
+
+	/**
+	 * @return The instructions used to evaluate
+	 */
+	Instructions getInstructions() const;
+
+	/**
+	 * @param disposition The disposition to evaluate
+	 * @return Positive if the PC's pieces are better placed
+	 */
+	int evaluate(const GameUtils::Disposition &disposition) const;
+
+	/**
+	 * Sets the disposition of ply 0
+	 */
+	void setRoot(const GameUtils::Disposition &disposition);
+
+	/**
+	 * Computes the state of ply + 1 after a move from the disposition of ply
+	 * @param ply The ply of before, its state is not changed
+	 * @param before The disposition of ply
+	 * @param after The disposition after the move
+	 */
+	void makeMove(int ply, const GameUtils::Disposition &before, const GameUtils::Disposition &after);
+
+	/**
+	 * @return The evaluation of the disposition of ply
+	 */
+	int evaluate(int ply) const;
+
+	/**
+	 * Evaluates the dispositions after some moves, without changing the state of ply + 1
+	 * @param ply The ply of disposition
+	 * @param disposition The disposition before the moves
+	 * @param moves The moves to evaluate
+	 * @param scores Array of moves.size() elements, filled with the evaluation of each move's disposition
+	 */
+	void evaluateMoves(int ply, const GameUtils::Disposition &disposition, const GameUtils::MoveList &moves,
+	                   int *scores) const;
+
+private:
+	/**
+	 * @return The evaluation of after, given before and its evaluation score
+	 */
+	typedef int (*EvaluateChildFunction)(const Tables &tables, const GameUtils::Disposition &before, int score,
+	                                     const GameUtils::Disposition &after);
+
+	Instructions mInstructions;
+	EvaluateChildFunction mEvaluateChild;
+
+	Weights mWeights;
+	Tables mTables;
+
+	Network mNetwork;
+	bool mUseNetwork = false;
+
+	/**
+	 * State of each ply: the score of the tables or the accumulator of the network
+	 */
+	std::vector<int> mScores;
+	std::vector<Network::Accumulator> mAccumulators;
+};
+
+#endif // EVALUATOR_H
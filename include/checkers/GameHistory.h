@@ -0,0 +1,131 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAME_HISTORY_H
+#define GAME_HISTORY_H
+
+#include "checkers/GameUtils.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// a position repeated this number of times is a draw
+#define DRAW_REPETITIONS 3
+
+// plies without captures and pawn moves (40 for each side) that make a draw
+#define DRAW_QUIET_PLIES 80
+
+/**
+ * Positions of a game, one for each ply, stored in a compact form so that any of them
+ * can be restored without replaying the moves
+ */
+class GameHistory {
+public:
+	/**
+	 * A position and the move that reached it, the pieces are bitmasks of the 32 dark squares
+	 */
+	struct Ply {
+		uint32_t pc, player, dames;
+		uint32_t eaten; // squares eaten by the move
+		uint64_t hash; // Zobrist hash of the position, updated incrementally
+		int8_t from, to; // the move, -1 for the first position
+		bool pcTurn; // true if the PC moves next
+		uint8_t quietPlies; // plies since the last capture or pawn move, positions before them cannot repeat
+	};
+
+	/**
+	 * Clears the history and adds the first position
+	 */
+	void reset(const GameUtils::Disposition &disposition, bool pcTurn);
+
+	/**
+	 * Adds the position after a move from the current one, the positions after the current one are removed
+	 * @param disposition The disposition after the move
+	 * @param from Starting position of the move
+	 * @param to Final position of the move
+	 */
+	void push(const GameUtils::Disposition &disposition, int from, int to);
+
+	/**
+	 * Changes the current ply, the following ones are kept until a new move is pushed
+	 * @return False if the ply does not exist
+	 */
+	bool goTo(size_t ply);
+
+	/**
+	 * @return The index of the current ply
+	 */
+	size_t getCurrent() const;
+
+	/**
+	 * @return The number of plies, including the ones after the current one
+	 */
+	size_t size() const;
+
+	const Ply &getPly(size_t ply) const;
+
+	/**
+	 * @return The disposition of the specified ply
+	 */
+	GameUtils::Disposition getDisposition(size_t ply) const;
+
+	/**
+	 * @return The positions eaten by the move that reached the specified ply
+	 */
+	std::vector<int> getEaten(size_t ply) const;
+
+	/**
+	 * @return How many times the position of the specified ply occurred until that ply, itself included
+	 */
+	int countRepetitions(size_t ply) const;
+
+	/**
+	 * @return True if the position of the specified ply is a draw by repetition or by the quiet plies rule
+	 */
+	bool isDraw(size_t ply) const;
+
+	/**
+	 * @return The hashes of the positions that can be repeated after the specified ply, oldest first,
+	 * the last one is the specified ply
+	 */
+	std::vector<uint64_t> getReversibleKeys(size_t ply) const;
+
+	/**
+	 * @return The same positions of getReversibleKeys() with the chessboard flipped (see GameUtils::flip()),
+	 * as a search of the player's move sees them
+	 */
+	std::vector<uint64_t> getFlippedReversibleKeys(size_t ply) const;
+
+	/**
+	 * @return The disposition of the pieces in the bitmasks of a Ply
+	 */
+	static GameUtils::Disposition unpack(uint32_t pc, uint32_t player, uint32_t dames);
+
+private:
+	std::vector<Ply> mPlies;
+	size_t mCurrent = 0;
+
+	static Ply pack(const GameUtils::Disposition &disposition);
+
+	/**
+	 * @return The position of a dark square on the chessboard
+	 */
+	static int toPosition(int square);
+};
+
+
+#endif // GAME_HISTORY_H
@@ -19,14 +19,17 @@
 #define GAME_UTILS_H
 
 #include <array>
+#include <cstdint>
 #include <vector>
 
-#define PAWN_SCORE 1
-#define DAME_SCORE 2
+class MoveArena;
+
+#define PAWN_SCORE 100
+#define DAME_SCORE 200
 
 /**
- * This class provides some utilities, such as a thread for calculating the PC's move
- * and a static method to find all possible moves
+ * This class provides some utilities, such as a static method to find all possible moves
+ * and a static method to hash a disposition
  */
 class GameUtils {
 public:
@@ -44,8 +47,8 @@ public:
 	typedef std::array<PieceType, 64> Disposition;
 
 	struct Move {
-		Move(const Disposition disposition, bool eatenFromPawn, int score) :
-			disposition(disposition), eatenFromPawn(eatenFromPawn), score(score) {}
+		Move(const Disposition disposition, bool eatenFromPawn, int score, int from, int to) :
+			disposition(disposition), eatenFromPawn(eatenFromPawn), score(score), from(from), to(to) {}
 
 		/**
 		 * The disposition after the move
@@ -61,6 +64,11 @@ public:
 		 * Score associated to the move
 		 */
 		const int score;
+
+		/**
+		 * Position of the moved piece before and after the move
+		 */
+		const int from, to;
 	};
 
 	/**
@@ -77,12 +85,55 @@ public:
 	static MoveList findMoves(const Disposition &disposition, bool player);
 
 	/**
-	 * Calculates the best move for the computer
-	 * @param disposition Current pieces' disposition
-	 * @param depth How many recursion levels are allowed
-	 * @return A possible move for the computer, or nullptr
+	 * Find what moves player can do, the moves are created in an arena
+	 * @param disposition The current disposition
+	 * @param player True if user, false if PC
+	 * @param moves Cleared and filled with the possible moves
+	 * @param arena The arena where the moves are created, or nullptr to allocate them with new
+	 * @return False if the arena is full and some moves are missing
+	 */
+	static bool findMoves(const Disposition &disposition, bool player, MoveList &moves, MoveArena *arena);
+
+	/**
+	 * Find the positions of the pieces eaten by a move
+	 * @param disposition The disposition before the move
+	 * @param move A move from the disposition
+	 * @return The positions of the eaten pieces
+	 */
+	static std::vector<int> findEaten(const Disposition &disposition, const Move &move);
+
+	/**
+	 * Find the positions reached by the moved piece, step by step
+	 * @param disposition The disposition before the move
+	 * @param move A move from the disposition
+	 * @return The positions after each step, the last one is move.to
 	 */
-	static GameUtils::Move *calculateBestMove(const GameUtils::Disposition &disposition, int depth);
+	static std::vector<int> findPath(const Disposition &disposition, const Move &move);
+
+	/**
+	 * Calculates the Zobrist hash of a disposition
+	 * @param disposition The disposition to hash
+	 * @param pcTurn True if the PC moves next
+	 * @return The hash key
+	 */
+	static uint64_t hash(const Disposition &disposition, bool pcTurn);
+
+	/**
+	 * Updates the Zobrist hash after a move, only the changed squares are hashed
+	 * @param key The hash of the disposition before the move
+	 * @param before The disposition before the move
+	 * @param after The disposition after the move
+	 * @return The hash of the disposition after the move, with the other side to move
+	 */
+	static uint64_t updateHash(uint64_t key, const Disposition &before, const Disposition &after);
+
+	/**
+	 * The same position seen by the other side: the board is rotated and the pieces change color,
+	 * so the player's moves are found as PC's moves. A position is moved to 63 - position
+	 * @param disposition The disposition to flip
+	 * @return The flipped disposition
+	 */
+	static Disposition flip(const Disposition &disposition);
 
 private:
 	GameUtils() = default;
@@ -90,20 +141,21 @@ private:
 	/**
 	 * Add a move step to find how long the move is
 	 */
-	static bool addMoveStep(MoveList &moves, const Disposition &disposition,
+	static bool addMoveStep(MoveList &moves, MoveArena *arena, const Disposition &disposition, int from,
 							int source_position, bool row_offset, bool col_offset, int score);
 
 	/**
-	 * Calculates the score of the best move
-	 * @param start_move
-	 * @param oldScore The current score
-	 * @param maximizing True if PC
-	 * @param depth How many levels of recursion to do
-	 * @param alpha Used by alpha-beta pruning
-	 * @param beta Used by alpha-beta pruning
-	 * @return The score after the best move, or INT_MIN if maximizing, or INT_MAX otherwise
+	 * Creates a move in the arena, or with new if the arena is nullptr, and adds it to moves
+	 */
+	static void addMove(MoveList &moves, MoveArena *arena, const Disposition &disposition, bool eatenFromPawn,
+						int score, int from, int to);
+
+	/**
+	 * Add the jumps from position to path until every eaten piece has been jumped
+	 * @return True if the path reaches the destination
 	 */
-	static int minimax(const GameUtils::Move *start_move, int oldScore, bool maximizing, int depth, int alpha, int beta);
+	static bool addPathStep(std::vector<int> &path, const Disposition &disposition, const Move &move,
+							const std::vector<int> &eaten, std::vector<bool> &jumped, int position);
 };
 
 #endif // GAME_UTILS_H
@@ -18,75 +18,216 @@
 #ifndef MATCH_MANAGER_H
 #define MATCH_MANAGER_H
 
+#include "checkers/CommandQueue.h"
+#include "checkers/Engine.h"
+#include "checkers/GameHistory.h"
 #include "checkers/GameUtils.h"
 #include <functional>
 #include <atomic>
+#include <mutex>
+#include <thread>
 
 #define DEF_MIN_GD 0
 #define DEF_MAX_GD 12
 
 /**
  * This class handles 1 or more matches
- * Note: non-const methods are not thread-safe
+ *
+ * The match is played by a thread owned by the manager: the commands (click, new match, undo...)
+ * are queued without locks from any thread and executed in order, none is dropped while the PC
+ * is thinking. The listeners are called only by that thread.
  *
  * You can instantiate 2 or more objects to manage multiple games concurrently.
  */
 class MatchManager {
 public:
-	static const int selectedNone = -1, minGD = DEF_MIN_GD, maxGD = DEF_MAX_GD;
+	static constexpr int selectedNone = -1, minGD = DEF_MIN_GD, maxGD = DEF_MAX_GD;
 
 	enum State {
 		TURN_PLAYER,
 		TURN_PC,
 		PLAYER_WON,
 		PC_WON,
+		DRAW, // by repetition or by the quiet plies rule, see GameHistory
 		ILLEGAL_SELECTION,
 		ILLEGAL_MOVE
 	};
 
+	/**
+	 * What the PC searches while waiting for the player's move
+	 */
+	enum PonderMode {
+		PONDER_OFF,
+		PONDER_PREDICTED, // only the reply the PC expects (from the principal variation), the default
+		PONDER_ALL // every legal reply, starting from the predicted one: each one costs a PC's move
+	};
+
+	/**
+	 * Changes of the chessboard since the previous update
+	 */
+	struct BoardDelta {
+		std::vector<std::pair<int, GameUtils::PieceType>> pieces; // changed squares, in order of change
+		std::vector<int> possibleMoves; // squares to highlight as possible moves
+		int selected = selectedNone; // square to highlight as selected
+		bool clear = false; // every highlight is removed before adding the new ones
+
+		bool isEmpty() const;
+
+		/**
+		 * Adds the changes of a newer delta to this one
+		 */
+		void merge(const BoardDelta &other);
+	};
+
 	class EventListener {
 		public:
 		virtual void onStateChange(State type) = 0;
-		virtual void onSquareSelected(int index) = 0;
-		virtual void onSquarePossibleMove(int index) = 0;
-		virtual void onSquareClear() = 0;
 
 		/**
-		 * Pointer ownership: caller
+		 * Called once for each step of the game with all the changes of the chessboard
 		 */
-		virtual void onUpdateDisposition(const GameUtils::Disposition *newDisposition) = 0;
+		virtual void onBoardUpdate(const BoardDelta &delta) = 0;
 	};
 
 	/**
 	 * Initialize the manager but you need to call newMatch() to start the game
+	 * @param engineConfig Memory used by the PC's engine
 	 */
-	explicit MatchManager() = default;
+	explicit MatchManager(const EngineConfig &engineConfig = EngineConfig());
 
 	virtual ~MatchManager();
 
+	/**
+	 * The node budget of a difficulty bounds the CPU time of each PC's move (and of the pondering
+	 * of each player's move with PONDER_PREDICTED), the weakening decreases as the difficulty increases
+	 * @param difficulty Between minGD and maxGD
+	 * @return How the PC searches at the specified difficulty
+	 */
+	static SearchLimits getDifficultyLimits(int difficulty);
+
 	/**
 	 * Add a event listener, the pointer must not be freed
 	 * until the caller removes the listener with removeEventListener()
+	 * Listeners receive only the changes, so they must be added before the first match
+	 * This method is thread safe, but it must not be called by a listener
 	 */
 	void addEventListener(EventListener *listener);
 
 	/**
-	 * Remove a event listener
+	 * Remove a event listener, it is not called anymore when the method returns
+	 * This method is thread safe, but it must not be called by a listener
 	 */
 	void removeEventListener(EventListener *listener);
 
 	/**
 	 * Click on the specified square
 	 * 0 <= index <= 63
+	 * This method is thread safe, the click is queued
 	*/
 	void squareClick(int index);
 
 	/**
 	 * Start a new match or reset the current match
+	 * This method is thread safe, the match is started by the match's thread
 	 * @return True if the specified difficulty is supported
 	 */
 	bool newMatch(int newDifficulty, bool isPcFirstPlayer);
 
+	/**
+	 * Takes back the player's last move and the PC's reply, the moves are kept until
+	 * the player makes a different one
+	 * This method is thread safe, the command is queued
+	 * @return False if there is nothing to undo, the commands still in the queue are not considered
+	 */
+	bool undo();
+
+	/**
+	 * Makes again the moves taken back with undo()
+	 * This method is thread safe, the command is queued
+	 * @return False if there is nothing to redo, the commands still in the queue are not considered
+	 */
+	bool redo();
+
+	/**
+	 * Goes to the position of the specified ply of the history, if the PC moves next
+	 * it goes to the position after the PC's move. The PC's clock is not restored
+	 * This method is thread safe, the command is queued
+	 * @param ply Index of the ply, 0 is the initial position
+	 * @return False if the ply does not exist, the commands still in the queue are not considered
+	 */
+	bool goToPly(size_t ply);
+
+	/**
+	 * Aborts the PC's search and the background searches, the match is paused until
+	 * newMatch(), undo(), redo() or goToPly()
+	 * This method is thread safe, the command is queued
+	 */
+	void stop();
+
+	/**
+	 * Use it only from the listeners, the history is changed by the match's thread
+	 * @return The positions of the current match
+	 */
+	const GameHistory &getHistory() const;
+
+	/**
+	 * This method is thread safe
+	 * @return The number of plies of the current match, including the initial position
+	 */
+	size_t getPlyCount() const;
+
+	/**
+	 * Change the ponder mode, it takes effect from the next player's turn
+	 * This method is thread safe
+	 */
+	void setPonderMode(PonderMode mode);
+
+	/**
+	 * This method is thread safe
+	 * @return Current ponder mode
+	 */
+	PonderMode getPonderMode() const;
+
+	/**
+	 * Searches a hint at the beginning of every player's turn, it takes effect from the next player's turn.
+	 * It is disabled by default, the hint is searched only when requestHint() is called
+	 * This method is thread safe
+	 */
+	void setHintEnabled(bool enabled);
+
+	/**
+	 * Starts searching a hint for the current player's turn, if it is not already searched
+	 * This method is thread safe, the command is queued
+	 */
+	void requestHint();
+
+	/**
+	 * While it is the player's turn a low-priority thread searches the player's best move,
+	 * deeper and deeper within the node budget of the difficulty, so the hint improves over time.
+	 * It is cancelled when the player moves
+	 * This method is thread safe
+	 * @param from Position of the piece to move
+	 * @param to Position of the piece after the move
+	 * @return False if there is no hint yet
+	 */
+	bool getHint(int &from, int &to) const;
+
+	/**
+	 * Makes the PC play with a clock instead of searching within the difficulty's limits,
+	 * it takes effect from the next match
+	 * @param time PC's time in milliseconds for each time control, or 0 to disable the clock
+	 * @param increment Time added after each PC's move in milliseconds
+	 * @param movesToGo Moves of each time control, or 0 if the time is for the whole game
+	 * This method is thread safe, the command is queued
+	 */
+	void setTimeControl(long time, long increment, int movesToGo);
+
+	/**
+	 * This method is thread safe
+	 * @return PC's time left in milliseconds, or 0 if there is no clock
+	 */
+	long getPcTime() const;
+
 	/**
 	 * This method is thread safe
 	 * @return Current difficulty
@@ -108,29 +249,226 @@ public:
 private:
 	MatchManager(const MatchManager &); // prevents copy-constructor
 
+	/**
+	 * A method called from another thread, executed by the match's thread
+	 */
+	struct Command {
+		enum Type {
+			CLICK,
+			NEW_MATCH,
+			UNDO,
+			REDO,
+			GO_TO_PLY,
+			TIME_CONTROL,
+			HINT,
+			STOP,
+			QUIT // ends the match's thread
+		};
+
+		Type type = QUIT;
+		long value = 0; // square, difficulty, ply or time
+		long increment = 0;
+		int movesToGo = 0;
+		bool isPcFirstPlayer = false;
+	};
+
+	/**
+	 * A player's move with its steps
+	 */
+	struct PlayerMove {
+		GameUtils::Move *move; // owned by mMoves
+		std::vector<int> path; // positions after each step, the last one is move->to
+		std::vector<int> eaten;
+	};
+
+	/**
+	 * Player's moves that start from a position
+	 */
+	struct SquareMoves {
+		std::vector<int> targets; // reachable positions, without duplicates
+		std::vector<PlayerMove> moves;
+	};
+
 	GameUtils::Disposition mDisposition{};
+	GameUtils::Disposition mShownDisposition{}; // disposition known by the listeners
+	GameHistory mHistory;
+	BoardDelta mPendingDelta;
 	GameUtils::MoveList mMoves{};
+	std::array<SquareMoves, 64> mMoveIndex{}; // mMoves indexed by the starting position
 	std::atomic<bool> mIsEnd = false, mIsPlaying = false;
 	std::atomic<int> mGameDifficulty;
 	int mSelectedPos = selectedNone;
 	std::vector<EventListener *> mListeners;
+	std::mutex mListenersMutex; // held while the listeners are called
+	Engine mEngine; // used by one thread at a time: the ponder thread or the caller's one
+	Engine mHintEngine; // used only by mHintThread
+
+	long mTimeControl = 0, mIncrement = 0;
+	int mMovesToGo = 0, mMovesLeft = 0;
+	std::atomic<long> mPcTime = 0;
+
+	CommandQueue<Command> mCommands;
+	std::thread mMatchThread;
+	std::atomic<bool> mStopSearch = false; // aborts the PC's search, a queued command replaces the position
+	std::atomic<int> mQueuedAborts = 0; // queued commands that abort the PC's search
+	std::atomic<size_t> mPlyCount = 0;
+	std::atomic<bool> mCanUndo = false, mCanRedo = false;
+
+	std::atomic<PonderMode> mPonderMode = PONDER_PREDICTED;
+	std::thread mPonderThread;
+	std::atomic<bool> mStopPonder = false;
+	GameUtils::MoveList mPonderReplies; // PC's reply to each move of mMoves, written only by mPonderThread
+	std::vector<std::pair<int, int>> mPonderPredictions; // player's move expected after each reply
+	std::pair<int, int> mPredictedReply{-1, -1}; // player's move expected after the PC's last move
+
+	/**
+	 * Publishes the best move of each iteration of the hint's search
+	 */
+	class HintListener : public Engine::SearchListener {
+		public:
+		explicit HintListener(std::atomic<int> &hint) : mHint(hint) {}
+
+		void onIteration(const SearchLine &line, int depth) override;
+
+		private:
+		std::atomic<int> &mHint;
+	};
+
+	std::atomic<bool> mHintEnabled = false;
+	std::thread mHintThread;
+	std::atomic<bool> mStopHint = false;
+	std::atomic<int> mHint = -1; // from * 64 + to, or -1 if there is no hint
+	HintListener mHintListener{mHint};
+
+	/**
+	 * Executes the commands until QUIT, in the match's thread
+	 */
+	void run();
+
+	/**
+	 * Queues a command that makes the current position useless, the PC's search is aborted
+	 * so the command does not wait for it
+	 */
+	void pushAborting(const Command &command);
+
+	/**
+	 * Called by the match's thread when it executes a command of pushAborting(), the PC's
+	 * searches are not aborted anymore if no other such command is queued
+	 */
+	void clearAbort();
+
+	/**
+	 * Executes a command, in the match's thread
+	 */
+	void execute(const Command &command);
+
+	/**
+	 * Updates the state of the history read by the other threads
+	 */
+	void publishHistory();
+
+	/**
+	 * Implementations of the commands
+	 */
+	bool processNewMatch(int newDifficulty, bool isPcFirstPlayer);
+	bool processUndo();
+	bool processRedo();
+	bool processGoToPly(size_t ply);
+
+	/**
+	 * The plies where undo() and redo() go
+	 * @return False if there is no such ply
+	 */
+	bool findUndoPly(size_t &ply) const;
+	bool findRedoPly(size_t &ply) const;
 
 	void changeState(State type);
 	void selectSquare(int index);
-	void makeSquarePossibleMove(int index);
+	void makeSquaresPossibleMove(const std::vector<int> &indexes);
 	void clearSquares();
-	void updateDisposition(GameUtils::Disposition *newDisposition);
+
+	/**
+	 * Adds the squares changed by mDisposition to the pending delta and clears the highlights
+	 */
+	void updateDisposition();
+
+	/**
+	 * Sends the pending delta to the listeners
+	 */
+	void flushBoard();
+
+	/**
+	 * Selects a piece or moves the selected piece
+	 */
+	void processClick(int currentPos);
 
 	/**
 	 * Start the game algorithm to make a move
+	 * @param pcMove Move already calculated while pondering (ownership: callee), or nullptr to search it now
+	 */
+	void makePCMove(GameUtils::Move *pcMove = nullptr);
+
+	/**
+	 * Updates the PC's clock after a move
+	 * @param elapsed Time used by the PC in milliseconds
+	 */
+	void updatePcClock(long elapsed);
+
+	/**
+	 * Start searching the PC's replies to mMoves in background
+	 */
+	void startPondering();
+
+	/**
+	 * Abort the background search and wait for it
+	 */
+	void stopPondering();
+
+	/**
+	 * Start searching a hint for the player in background, the hint's thread must not be running
 	 */
-	void makePCMove();
+	void startHint();
+
+	/**
+	 * Abort the search of the hint and wait for it, the hint is discarded
+	 */
+	void stopHint();
+
+	/**
+	 * Stops the background searches (pondering and hint), takes the PC's reply to the specified
+	 * player's move and discards the others
+	 * @param playerMove A move of mMoves, or nullptr to discard every reply
+	 * @return The reply found while pondering (ownership: caller), or nullptr
+	 */
+	GameUtils::Move *takePonderedReply(const GameUtils::Move *playerMove);
+
+	/**
+	 * Ends the game if the current position is a draw
+	 * @return True if the game ended
+	 */
+	bool checkDraw();
+
+	/**
+	 * Shows the position of the specified ply and gives the turn to the player
+	 * @param ply A ply of the history where the player moves next, or the last one
+	 */
+	void restorePly(size_t ply);
+
+	/**
+	 * @return True if the player moves next in the specified ply, or if it ends the game
+	 */
+	bool isPlayerPly(size_t ply) const;
 
 	/**
 	 * Resets mDisposition to the default disposition of the chessboard
 	 */
 	void setDefaultLayout();
 
+	/**
+	 * Finds the player's moves from mDisposition and indexes them by the starting position
+	 */
+	void findPlayerMoves();
+
 	/**
 	 * @param oldIndex Selected position
 	 * @param newIndex Final position
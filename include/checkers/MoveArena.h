@@ -0,0 +1,83 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOVE_ARENA_H
+#define MOVE_ARENA_H
+
+#include "checkers/GameUtils.h"
+#include <cstddef>
+#include <memory>
+
+/**
+ * Preallocated memory for the moves of a search. Moves are allocated in a stack:
+ * a node takes a mark before finding its moves and releases them all at once when it returns.
+ * The moves are never deleted
+ */
+class MoveArena {
+public:
+	/**
+	 * @param size Bytes of the arena, rounded down to a multiple of the size of a move
+	 */
+	explicit MoveArena(size_t size);
+
+	/**
+	 * Constructs a move in the arena
+	 * @return The new move, or nullptr if the arena is full
+	 */
+	GameUtils::Move *create(const GameUtils::Disposition &disposition, bool eatenFromPawn, int score,
+	                        int from, int to);
+
+	/**
+	 * @return The current top of the stack, to be passed to release()
+	 */
+	size_t mark() const;
+
+	/**
+	 * Frees the moves created after the mark
+	 */
+	void release(size_t mark);
+
+	/**
+	 * Frees every move, in constant time
+	 */
+	void reset();
+
+	/**
+	 * @return True if a move could not be created since the last release() or reset()
+	 */
+	bool hasOverflowed() const;
+
+	/**
+	 * @return Size of the arena in bytes
+	 */
+	size_t getSize() const;
+
+	/**
+	 * @return Maximum number of bytes used since the arena was created
+	 */
+	size_t getPeakUsage() const;
+
+private:
+	MoveArena(const MoveArena &); // prevents copy-constructor
+
+	std::unique_ptr<std::byte[]> mBuffer;
+	size_t mCapacity, mTop = 0, mPeak = 0; // in moves
+	bool mOverflow = false;
+};
+
+
+#endif // MOVE_ARENA_H
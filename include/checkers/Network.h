@@ -0,0 +1,120 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include "checkers/GameUtils.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define NETWORK_INPUTS 128 // 4 kinds of pieces on 32 dark squares
+#define NETWORK_HIDDEN 64
+#define NETWORK_OUTPUT_SCALE 64 // the output layer's sum is divided by this
+
+/**
+ * Quantized neural network that evaluates a disposition from the PC's point of view, like the
+ * piece-square tables of Evaluator. It has one hidden layer: the accumulator (16-bit) is the sum
+ * of the weights of the pieces on the board, so a move only adds and subtracts the weights of
+ * the changed squares. The hidden values are clamped to [0, 127] and multiplied by the 8-bit
+ * weights of the output.
+ *
+ * File format (little-endian): "CKNN", uint32 version (1), uint32 inputs, uint32 hidden,
+ * int16 hidden biases[hidden], int16 weights[inputs][hidden], int8 output weights[hidden],
+ * int32 output bias. The input of a piece is (piece type - 1) * 32 + position / 2
+ */
+class Network {
+public:
+	struct Accumulator {
+		alignas(32) std::array<int16_t, NETWORK_HIDDEN> values;
+	};
+
+	/**
+	 * Creates a network with all the weights set to 0
+	 * @param vectorized True if AVX2 can be used, when the CPU supports it
+	 */
+	explicit Network(bool vectorized = true);
+
+	/**
+	 * Loads the weights from a file
+	 * @param path Path of the file
+	 * @return False if the file cannot be read or it is not a valid network, the old weights are kept
+	 */
+	bool load(const std::string &path);
+
+	/**
+	 * @return True if the weights were loaded
+	 */
+	bool isLoaded() const;
+
+	/**
+	 * @return True if AVX2 is used
+	 */
+	bool isVectorized() const;
+
+	/**
+	 * Computes the accumulator of a disposition from scratch
+	 */
+	void refresh(const GameUtils::Disposition &disposition, Accumulator &accumulator) const;
+
+	/**
+	 * Computes the accumulator after a move from the one before it
+	 * @param accumulator The accumulator of before
+	 * @param before The disposition before the move
+	 * @param after The disposition after the move
+	 * @param result The accumulator of after, it can be the same object as accumulator
+	 */
+	void update(const Accumulator &accumulator, const GameUtils::Disposition &before,
+	            const GameUtils::Disposition &after, Accumulator &result) const;
+
+	/**
+	 * @return Positive if the PC's pieces are better placed, bounded so that it fits the transposition table
+	 */
+	int evaluate(const Accumulator &accumulator) const;
+
+	/**
+	 * @return The input of a piece on a position, or -1 if the square is empty
+	 */
+	static int getInput(GameUtils::PieceType piece, int position);
+
+private:
+	Network(const Network &); // prevents copy-constructor
+
+	/**
+	 * Adds the weights of the pieces in after and subtracts the ones in before for each changed square
+	 */
+	typedef void (*UpdateFunction)(const int16_t *weights, const Accumulator &accumulator,
+	                               const GameUtils::Disposition &before, const GameUtils::Disposition &after,
+	                               Accumulator &result);
+
+	/**
+	 * @return The sum of the clamped hidden values multiplied by the output weights
+	 */
+	typedef int32_t (*OutputFunction)(const int8_t *outputWeights, const Accumulator &accumulator);
+
+	std::vector<int16_t> mHiddenBiases, mWeights; // weights of input i from mWeights[i * NETWORK_HIDDEN]
+	std::vector<int8_t> mOutputWeights;
+	int32_t mOutputBias = 0;
+	bool mLoaded = false, mVectorized = false;
+
+	UpdateFunction mUpdate;
+	OutputFunction mOutput;
+};
+
+#endif // NETWORK_H
@@ -0,0 +1,88 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TIME_MANAGER_H
+#define TIME_MANAGER_H
+
+#include <chrono>
+
+// time kept for the communication with the frontend, in milliseconds
+#define MOVE_OVERHEAD 30
+
+// expected number of moves left when the time control does not specify it
+#define DEF_MOVES_TO_GO 30
+
+/**
+ * This class decides how long the PC can think about a move in a game with a clock
+ *
+ * The soft limit is the time the search should use: a new iteration of the search is not started
+ * after half of it. The hard limit is never exceeded, the search is aborted when it is reached.
+ */
+class TimeManager {
+public:
+	TimeManager() = default;
+
+	/**
+	 * Starts the clock of a new move
+	 * @param remaining Time left on the clock in milliseconds
+	 * @param increment Time added after each move in milliseconds
+	 * @param movesToGo Moves until the next time control, or 0 if the remaining time is for the whole game
+	 */
+	void start(long remaining, long increment, int movesToGo);
+
+	/**
+	 * The move is forced (e.g. there is only 1 legal move), so the search stops as soon as possible
+	 */
+	void setForced();
+
+	/**
+	 * Called after each completed iteration of the search
+	 * @param bestMoveChanged True if the best move is not the one of the previous iteration
+	 */
+	void onIteration(bool bestMoveChanged);
+
+	/**
+	 * @return True if there is enough time to start a new iteration
+	 */
+	bool canStartIteration() const;
+
+	/**
+	 * @return True if the search must be aborted
+	 */
+	bool isHardLimitReached() const;
+
+	/**
+	 * @return Milliseconds elapsed since start()
+	 */
+	long elapsed() const;
+
+	long getSoftLimit() const;
+
+	long getHardLimit() const;
+
+private:
+	std::chrono::steady_clock::time_point mStart;
+	long mOptimum = 0, mHardLimit = 0;
+
+	/**
+	 * The soft limit is mOptimum * mStability, more if the best move keeps changing
+	 */
+	double mStability = 1.0;
+	bool mForced = false;
+};
+
+#endif // TIME_MANAGER_H
@@ -0,0 +1,135 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRAINING_DATA_H
+#define TRAINING_DATA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define TRAINING_PC_TURN 1 // flag of a position where the PC moves next
+
+/**
+ * A position of a game labelled with the score of the search and the result of the game.
+ * Scores and results are from the PC's point of view
+ */
+struct TrainingRecord {
+	uint32_t pc, player, dames; // bitmasks of the 32 dark squares, see GameHistory::unpack()
+	int16_t score; // in the units of PAWN_SCORE, with the material
+	int8_t result; // 1 if the PC won, -1 if the player won, 0 if draw
+	uint8_t flags;
+};
+
+static_assert(sizeof(TrainingRecord) == 16, "records are stored as they are in memory");
+
+/**
+ * Writes records to a sequence of files (shards) with the same number of records each.
+ * The records are buffered, so the memory used does not depend on the number of records.
+ *
+ * A shard is a 16-byte header ("CKTD", uint32 version, uint32 record size, uint32 0) followed by
+ * the records, in the byte order of the machine
+ */
+class TrainingWriter {
+public:
+	/**
+	 * @param prefix The shards are called prefix-00000.bin, prefix-00001.bin, ...
+	 * @param shardRecords Maximum number of records of a shard
+	 */
+	TrainingWriter(const std::string &prefix, size_t shardRecords);
+
+	/**
+	 * Closes the last shard
+	 */
+	~TrainingWriter();
+
+	/**
+	 * Adds a record, a new shard is started when the current one is full
+	 * @return False if the record cannot be written
+	 */
+	bool write(const TrainingRecord &record);
+
+	/**
+	 * Writes the buffered records and closes the current shard
+	 * @return False if the records cannot be written
+	 */
+	bool close();
+
+	/**
+	 * @return The number of shards created
+	 */
+	size_t getShards() const;
+
+private:
+	TrainingWriter(const TrainingWriter &); // prevents copy-constructor
+
+	std::string mPrefix;
+	size_t mShardRecords;
+	std::vector<TrainingRecord> mBuffer;
+	std::ofstream mFile;
+	size_t mShards = 0, mFileRecords = 0;
+
+	/**
+	 * Writes the buffered records to the current shard
+	 */
+	bool flush();
+};
+
+/**
+ * Maps a shard written by TrainingWriter in memory, the records are read directly from the file (or
+ * from a copy where files cannot be mapped)
+ */
+class TrainingReader {
+public:
+	TrainingReader() = default;
+
+	~TrainingReader();
+
+	/**
+	 * Maps a shard, the previous one is closed
+	 * @return False if the file cannot be mapped or it is not a valid shard
+	 */
+	bool open(const std::string &path);
+
+	/**
+	 * Unmaps the current shard
+	 */
+	void close();
+
+	/**
+	 * @return The number of records of the shard
+	 */
+	size_t size() const;
+
+	const TrainingRecord &operator[](size_t index) const;
+
+	const TrainingRecord *begin() const;
+
+	const TrainingRecord *end() const;
+
+private:
+	TrainingReader(const TrainingReader &); // prevents copy-constructor
+
+	void *mMapping = nullptr;
+	size_t mMappingSize = 0;
+	const TrainingRecord *mRecords = nullptr;
+	size_t mSize = 0;
+};
+
+#endif // TRAINING_DATA_H
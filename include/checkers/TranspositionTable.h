@@ -0,0 +1,127 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fixed-size hash table of already searched positions, shared by consecutive searches.
+ * Probes are random accesses, so large tables are allocated in huge pages when possible
+ * to avoid TLB misses
+ */
+class TranspositionTable {
+public:
+	enum Bound : uint8_t {
+		BOUND_NONE = 0,
+		BOUND_EXACT,
+		BOUND_LOWER, // the score is at least the stored one
+		BOUND_UPPER  // the score is at most the stored one
+	};
+
+	struct Entry {
+		uint64_t key;
+
+		/**
+		 * Score of the subtree relative to the position, so that it does not depend on the search root
+		 */
+		int16_t score;
+		int8_t depth;
+		Bound bound;
+
+		/**
+		 * Best move found (from and to positions), or -1
+		 */
+		int8_t from, to;
+
+		/**
+		 * Search that wrote the entry, older entries are replaced first
+		 */
+		uint8_t generation;
+	};
+
+	enum Pages : uint8_t {
+		PAGES_NORMAL = 0,
+		PAGES_TRANSPARENT_HUGE, // the kernel was advised to use huge pages when it can
+		PAGES_HUGE // explicit huge pages reserved by the system
+	};
+
+	/**
+	 * Creates an empty table
+	 * @param size Number of entries, rounded down to a power of 2
+	 * @param interleave True if the memory is spread among all the NUMA nodes, for searches
+	 * that run on several nodes. Otherwise it is allocated on the node of the calling thread
+	 */
+	explicit TranspositionTable(size_t size, bool interleave = false);
+
+	~TranspositionTable();
+
+	/**
+	 * @return Pages used by the table
+	 */
+	Pages getPages() const;
+
+	/**
+	 * @return True if the table is interleaved among the NUMA nodes
+	 */
+	bool isInterleaved() const;
+
+	/**
+	 * @return Size of the table in bytes
+	 */
+	size_t getSize() const;
+
+	/**
+	 * Removes every entry
+	 */
+	void clear();
+
+	/**
+	 * Must be called before each search to age the old entries
+	 */
+	void newSearch();
+
+	/**
+	 * @param key Hash key of the position
+	 * @return The entry of the position, or nullptr
+	 */
+	const Entry *probe(uint64_t key) const;
+
+	/**
+	 * Stores a position, keeping the deeper entry of the current search if there is a collision
+	 */
+	void store(uint64_t key, int score, int depth, Bound bound, int from, int to);
+
+private:
+	TranspositionTable(const TranspositionTable &); // prevents copy-constructor
+
+	Entry *mEntries = nullptr;
+	size_t mMask;
+	size_t mMappedSize = 0; // bytes mapped with mmap, 0 if allocated with new
+	Pages mPages = PAGES_NORMAL;
+	bool mInterleaved = false;
+	uint8_t mGeneration = 0;
+
+	/**
+	 * Allocates the entries, trying huge pages first
+	 */
+	void allocate(size_t size, bool interleave);
+};
+
+#endif // TRANSPOSITION_TABLE_H
@@ -0,0 +1,258 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "checkers/CApi.h"
+
+#include "checkers/Engine.h"
+#include "checkers/MatchManager.h"
+#include "checkers/Version.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <new>
+
+// the squares are cast to GameUtils::PieceType
+static_assert(+CHECKERS_EMPTY == +GameUtils::EMPTY && +CHECKERS_PC_PAWN == +GameUtils::PC_PAWN &&
+              +CHECKERS_PC_DAME == +GameUtils::PC_DAME && +CHECKERS_PLAYER_PAWN == +GameUtils::PLAYER_PAWN &&
+              +CHECKERS_PLAYER_DAME == +GameUtils::PLAYER_DAME,
+              "checkers_piece must match GameUtils::PieceType");
+
+struct checkers_engine {
+	explicit checkers_engine(const EngineConfig &config) : engine(config) {}
+
+	Engine engine;
+	std::atomic<bool> stop = false; // set by checkers_engine_stop(), cleared when a search returns
+};
+
+/**
+ * Converts an array of squares to a disposition
+ * @return False if a square does not contain a piece type
+ */
+static bool toDisposition(const uint8_t squares[64], GameUtils::Disposition &disposition) {
+	if (!squares) return false;
+
+	for (int i = 0; i < 64; i++) {
+		if (squares[i] > CHECKERS_PLAYER_DAME) return false;
+		disposition[i] = static_cast<GameUtils::PieceType>(squares[i]);
+	}
+
+	return true;
+}
+
+/**
+ * Fills a move of the C interface, the positions of a flipped chessboard are flipped back
+ * @param after The disposition after the move
+ */
+static void toMove(int from, int to, const GameUtils::Disposition &after, bool flipped, int score,
+                   checkers_move &move) {
+	const GameUtils::Disposition disposition = flipped ? GameUtils::flip(after) : after;
+	move.from = flipped ? 63 - from : from;
+	move.to = flipped ? 63 - to : to;
+	std::copy(disposition.begin(), disposition.end(), move.squares);
+	move.score = score;
+}
+
+/**
+ * Searches the best moves of the side that moves, the lines are read with Engine::getLines()
+ * @param limits NULL to use the default limits
+ * @return The best move (ownership: caller), or nullptr if there are no moves, the search was stopped
+ * or the memory is not enough
+ */
+static GameUtils::Move *search(checkers_engine *engine, const GameUtils::Disposition &disposition, bool flipped,
+                               const checkers_limits *limits, int candidates) {
+	checkers_limits defaults;
+	if (!limits) {
+		checkers_limits_init(&defaults);
+		limits = &defaults;
+	}
+
+	SearchLimits searchLimits;
+	searchLimits.depth = std::clamp(limits->depth, 0, MAX_DEPTH);
+	searchLimits.nodes = limits->nodes;
+	searchLimits.candidates = candidates;
+
+	TimeManager timeManager;
+	bool clock = limits->time > 0;
+	if (clock)
+		timeManager.start(limits->time, std::max(limits->increment, 0L), std::max(limits->moves_to_go, 0));
+
+	// the engine always plays the PC
+	GameUtils::Move *best;
+	try {
+		best = engine->engine.calculateBestMove(flipped ? GameUtils::flip(disposition) : disposition, searchLimits,
+		                                        &engine->stop, clock ? &timeManager : nullptr);
+	} catch (const std::exception &) {
+		best = nullptr;
+	}
+
+	// a stop that arrived before the search started has stopped it, the flag is not cleared earlier
+	engine->stop = false;
+	return best;
+}
+
+const char *checkers_version(void) {
+	return CHECKERS_VERSION;
+}
+
+void checkers_config_init(checkers_config *config) {
+	if (!config) return;
+
+	EngineConfig defaults;
+	config->tt_size = defaults.ttSize;
+	config->arena_size = defaults.arenaSize;
+	config->selective_search = defaults.selectiveSearch;
+	config->weights_file = nullptr;
+	config->network_file = nullptr;
+}
+
+void checkers_limits_init(checkers_limits *limits) {
+	if (!limits) return;
+
+	// a search with the defaults ends like a PC's move at the strongest difficulty
+	SearchLimits defaults = MatchManager::getDifficultyLimits(MatchManager::maxGD);
+	limits->depth = defaults.depth;
+	limits->nodes = defaults.nodes;
+	limits->time = 0;
+	limits->increment = 0;
+	limits->moves_to_go = 0;
+}
+
+checkers_engine *checkers_engine_create(const checkers_config *config) {
+	EngineConfig engineConfig;
+	if (config) {
+		engineConfig.ttSize = config->tt_size;
+		engineConfig.arenaSize = config->arena_size;
+		engineConfig.selectiveSearch = config->selective_search != 0;
+		if (config->weights_file) engineConfig.weightsFile = config->weights_file;
+		if (config->network_file) engineConfig.networkFile = config->network_file;
+	}
+
+	// exceptions must not reach the C caller
+	try {
+		return new checkers_engine(engineConfig);
+	} catch (const std::exception &) {
+		return nullptr;
+	}
+}
+
+void checkers_engine_destroy(checkers_engine *engine) {
+	delete engine;
+}
+
+void checkers_engine_new_game(checkers_engine *engine) {
+	if (!engine) return;
+
+	engine->engine.newGame();
+	engine->stop = false;
+}
+
+int checkers_engine_set_history(checkers_engine *engine, const uint64_t *keys, size_t count) {
+	if (!engine || (!keys && count > 0)) return -1;
+
+	try {
+		engine->engine.setGameHistory(std::vector<uint64_t>(keys, keys + count));
+	} catch (const std::exception &) {
+		return -1;
+	}
+
+	return 0;
+}
+
+int checkers_engine_search(checkers_engine *engine, const uint8_t squares[64], int player,
+                           const checkers_limits *limits, checkers_move *move) {
+	GameUtils::Disposition disposition;
+	if (!engine || !move || !toDisposition(squares, disposition)) return -1;
+
+	bool flipped = player != 0;
+	GameUtils::Move *best = search(engine, disposition, flipped, limits, 1);
+	if (!best) return 0;
+
+	toMove(best->from, best->to, best->disposition, flipped, engine->engine.getStats().score, *move);
+	delete best;
+	return 1;
+}
+
+int checkers_engine_analyze(checkers_engine *engine, const uint8_t squares[64], int player,
+                            const checkers_limits *limits, checkers_move *lines, size_t capacity) {
+	GameUtils::Disposition disposition;
+	if (!engine || !lines || capacity < 1 || !toDisposition(squares, disposition)) return -1;
+
+	bool flipped = player != 0;
+	int candidates = static_cast<int>(std::min<size_t>(capacity, INT_MAX));
+	GameUtils::Move *best = search(engine, disposition, flipped, limits, candidates);
+	if (!best) return 0;
+	delete best;
+
+	const std::vector<SearchLine> &found = engine->engine.getLines();
+	for (size_t i = 0; i < found.size() && i < capacity; i++)
+		toMove(found[i].from, found[i].to, found[i].disposition, flipped, found[i].score, lines[i]);
+
+	return static_cast<int>(std::min(found.size(), capacity));
+}
+
+void checkers_engine_stop(checkers_engine *engine) {
+	if (engine) engine->stop = true;
+}
+
+void checkers_engine_get_stats(const checkers_engine *engine, checkers_stats *stats) {
+	if (!engine || !stats) return;
+
+	EngineStats engineStats = engine->engine.getStats();
+	stats->nodes = engineStats.nodes;
+	stats->score = engineStats.score;
+	stats->depth = engineStats.depth;
+	stats->tt_size = engineStats.ttSize;
+	stats->arena_size = engineStats.arenaSize;
+	stats->arena_peak = engineStats.arenaPeak;
+	stats->peak_rss = engineStats.peakRss;
+}
+
+size_t checkers_find_moves(const uint8_t squares[64], int player, checkers_move *moves, size_t capacity) {
+	GameUtils::Disposition disposition;
+	if (!toDisposition(squares, disposition)) return 0;
+
+	GameUtils::MoveList list;
+	try {
+		list = GameUtils::findMoves(disposition, player != 0);
+	} catch (const std::exception &) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < list.size(); i++) {
+		if (moves && i < capacity)
+			toMove(list[i]->from, list[i]->to, list[i]->disposition, false, 0, moves[i]);
+		delete list[i];
+	}
+
+	return list.size();
+}
+
+uint64_t checkers_hash(const uint8_t squares[64], int pc_turn) {
+	GameUtils::Disposition disposition;
+	if (!toDisposition(squares, disposition)) return 0;
+
+	return GameUtils::hash(disposition, pc_turn != 0);
+}
+
+uint64_t checkers_history_key(const uint8_t squares[64], int pc_turn, int player) {
+	GameUtils::Disposition disposition;
+	if (!toDisposition(squares, disposition)) return 0;
+
+	// the searches of the player see the chessboard as in checkers_engine_search()
+	if (player != 0)
+		return GameUtils::hash(GameUtils::flip(disposition), pc_turn == 0);
+	return GameUtils::hash(disposition, pc_turn != 0);
+}
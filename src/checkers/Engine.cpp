@@ -0,0 +1,574 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/Engine.h"
+
+#include <algorithm>
+#include <climits>
+#include <random>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// the clock and the node budget are checked once every BUDGET_CHECK_NODES nodes
+#define BUDGET_CHECK_NODES 1024
+
+// scores stored in the transposition table instead of INT_MIN and INT_MAX
+#define TT_LOSS (-32000)
+#define TT_WIN 32000
+
+// selective search: late quiet moves are searched with a reduced depth first (late move reductions)
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 3
+#define LMR_REDUCTION 1
+
+// selective search: quiet nodes near the leaves whose score is far from the window are pruned
+#define FUTILITY_DEPTH 2
+#define FUTILITY_MARGIN 80 // for each level of depth
+#define RAZOR_DEPTH 3
+#define RAZOR_MARGIN 240
+
+/**
+ * Converts a score to a score relative to the position, independent of the search root
+ */
+static int toTableScore(int score, int oldScore) {
+	if (score == INT_MIN) return TT_LOSS;
+	if (score == INT_MAX) return TT_WIN;
+	return score - oldScore;
+}
+
+static int fromTableScore(int score, int oldScore) {
+	if (score == TT_LOSS) return INT_MIN;
+	if (score == TT_WIN) return INT_MAX;
+	return score + oldScore;
+}
+
+/**
+ * @return True if the position before the move cannot occur again: a piece is eaten or a pawn moves
+ */
+static bool isIrreversible(const GameUtils::Disposition &disposition, const GameUtils::Move &move) {
+	return move.score > 0 || disposition[move.from] == GameUtils::PC_PAWN ||
+	       disposition[move.from] == GameUtils::PLAYER_PAWN;
+}
+
+/**
+ * @return The material won by the side that moves: the eaten pieces and the promotion of a pawn
+ */
+static int materialGain(const GameUtils::Disposition &disposition, const GameUtils::Move &move) {
+	GameUtils::PieceType piece = disposition[move.from], moved = move.disposition[move.to];
+	bool promotion = (piece == GameUtils::PC_PAWN && moved == GameUtils::PC_DAME) ||
+	                 (piece == GameUtils::PLAYER_PAWN && moved == GameUtils::PLAYER_DAME);
+	return promotion ? move.score + DAME_SCORE - PAWN_SCORE : move.score;
+}
+
+/**
+ * @return PC's material minus player's material
+ */
+static int materialBalance(const GameUtils::Disposition &disposition) {
+	int balance = 0;
+	for (GameUtils::PieceType piece: disposition) {
+		if (piece == GameUtils::PC_PAWN) balance += PAWN_SCORE;
+		else if (piece == GameUtils::PC_DAME) balance += DAME_SCORE;
+		else if (piece == GameUtils::PLAYER_PAWN) balance -= PAWN_SCORE;
+		else if (piece == GameUtils::PLAYER_DAME) balance -= DAME_SCORE;
+	}
+
+	return balance;
+}
+
+/**
+ * @return The peak resident memory of the process in bytes, or 0 if it is not available
+ */
+static size_t peakResidentSize() {
+#if defined(__unix__) || defined(__APPLE__)
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return static_cast<size_t>(usage.ru_maxrss); // bytes
+#else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @return The configuration with the values that the engine supports
+ */
+static EngineConfig sanitize(EngineConfig config) {
+	config.threads = 1;
+	return config;
+}
+
+Engine::Engine(const EngineConfig &config) : mConfig(sanitize(config)),
+                                             mTable(config.ttSize / sizeof(TranspositionTable::Entry),
+                                                    mConfig.interleaveTable),
+                                             mArena(config.arenaSize), mEvaluator(MAX_PLY + 1),
+                                             mRandom(std::random_device()()) {
+	mConfig.ttSize = mTable.getSize();
+	mConfig.arenaSize = mArena.getSize();
+
+	if (!mConfig.weightsFile.empty() && !mEvaluator.loadWeights(mConfig.weightsFile))
+		mConfig.weightsFile.clear();
+
+	// without a valid network the piece-square tables are used
+	if (!mConfig.networkFile.empty() && !mEvaluator.loadNetwork(mConfig.networkFile))
+		mConfig.networkFile.clear();
+	for (GameUtils::MoveList &moves: mMoves)
+		moves.reserve(32);
+	mLeafScores.reserve(32);
+}
+
+const EngineConfig &Engine::getConfig() const {
+	return mConfig;
+}
+
+EngineStats Engine::getStats() const {
+	EngineStats stats;
+	stats.nodes = mNodes;
+	stats.score = mLastScore;
+	stats.depth = mLastDepth;
+	stats.evalInstructions = mEvaluator.getInstructions();
+	stats.network = mEvaluator.hasNetwork();
+	stats.ttSize = mTable.getSize();
+	stats.ttPages = mTable.getPages();
+	stats.ttInterleaved = mTable.isInterleaved();
+	stats.arenaSize = mArena.getSize();
+	stats.arenaPeak = mArena.getPeakUsage();
+	stats.peakRss = peakResidentSize();
+	return stats;
+}
+
+void Engine::newGame() {
+	mTable.clear();
+	for (auto &side: mHistory) {
+		for (auto &row: side)
+			row.fill(0);
+	}
+	mLastPvLength = 0;
+	mGameKeys.clear();
+}
+
+void Engine::setGameHistory(const std::vector<uint64_t> &keys) {
+	mGameKeys = keys;
+}
+
+GameUtils::Move *Engine::calculateBestMove(const GameUtils::Disposition &disposition, int depth,
+                                           const std::atomic<bool> *stop, TimeManager *timeManager) {
+	SearchLimits limits;
+	limits.depth = depth;
+	return calculateBestMove(disposition, limits, stop, timeManager);
+}
+
+GameUtils::Move *Engine::calculateBestMove(const GameUtils::Disposition &disposition, const SearchLimits &limits,
+                                           const std::atomic<bool> *stop, TimeManager *timeManager) {
+	mLastLines.clear();
+	int depth = limits.depth;
+	if (depth < 0) return nullptr;
+
+	GameUtils::MoveList moves = GameUtils::findMoves(disposition, false);
+	if (moves.empty()) return nullptr;
+
+	mNodes = 0;
+	mLastScore = mLastDepth = 0;
+
+	// forced move: there is nothing to search
+	if (std::all_of(moves.begin(), moves.end(), [&](const GameUtils::Move *move) {
+		return move->disposition == moves.front()->disposition;
+	})) {
+		for (auto it = moves.begin() + 1; it != moves.end(); it++)
+			delete *it;
+		if (timeManager)
+			timeManager->setForced();
+
+		SearchLine &line = mLastLines.emplace_back();
+		line.from = moves.front()->from;
+		line.to = moves.front()->to;
+		line.disposition = moves.front()->disposition;
+		line.score = materialBalance(line.disposition) + mEvaluator.evaluate(line.disposition);
+		line.pv.emplace_back(line.from, line.to);
+		mLastPvLength = 0;
+		return moves.front();
+	}
+
+	mStop = stop;
+	mTimeManager = timeManager;
+	mNodeLimit = limits.nodes;
+	mOutOfBudget = false;
+	mSelective = mConfig.selectiveSearch && limits.candidates <= 1;
+	mNodes = mNextBudgetCheck = 0;
+	mTable.newSearch();
+	mArena.reset();
+
+	// old cut-offs are less relevant than the new ones
+	for (auto &side: mHistory) {
+		for (auto &row: side) {
+			for (int &value: row)
+				value /= 2;
+		}
+	}
+
+	uint64_t key = GameUtils::hash(disposition, true);
+	const TranspositionTable::Entry *entry = mTable.probe(key);
+
+	// scores are relative to the root, a draw is worth as much as losing the root's advantage
+	mDrawScore = -materialBalance(disposition);
+	mKeys = mGameKeys;
+	mKeyBase = static_cast<int>(mKeys.size());
+	mKeys.resize(mKeyBase + MAX_PLY + 1);
+	mKeys[mKeyBase] = key;
+	mEvaluator.setRoot(disposition);
+
+	// moves with same score are chosen randomly
+	std::shuffle(moves.begin(), moves.end(), std::random_device());
+	orderMoves(disposition, moves, true, entry ? entry->from : -1, entry ? entry->to : -1);
+
+	if (limits.blunderPercent > 0 && std::uniform_int_distribution(0, 99)(mRandom) < limits.blunderPercent)
+		depth = std::min(depth, 1);
+
+	// iterative deepening: each iteration fills the table and orders the moves for the next one
+	size_t candidates = std::max(limits.candidates, 1);
+	std::vector<RootLine> resCandidates; // best first
+	GameUtils::Move *res_move = nullptr;
+	for (int iteration = 0; iteration <= depth; iteration++) {
+		if (iteration > 0 && timeManager && !timeManager->canStartIteration())
+			break;
+
+		// the window is open until all the candidates have a score, then only better moves are exact
+		std::vector<RootLine> iterationCandidates;
+		int alpha = INT_MIN;
+		for (GameUtils::Move *move: moves) {
+			mRepetitionStart[1] = isIrreversible(disposition, *move) ? mKeyBase + 1 : 0;
+			mEvaluator.makeMove(0, disposition, move->disposition);
+			int score = minimax(move->disposition, materialGain(disposition, *move), false, iteration, 1, alpha, INT_MAX);
+			if (isStopped()) break;
+
+			if (alpha == INT_MIN || score > alpha) {
+				auto it = std::find_if(iterationCandidates.begin(), iterationCandidates.end(),
+				                       [score](const RootLine &candidate) { return candidate.score < score; });
+				updatePv(0, move);
+				it = iterationCandidates.insert(it, RootLine{move, score, {}});
+				it->pv.assign(mPv[0].begin(), mPv[0].begin() + mPvLength[0]);
+				if (iterationCandidates.size() > candidates)
+					iterationCandidates.pop_back();
+				if (iterationCandidates.size() == candidates)
+					alpha = iterationCandidates.back().score;
+			}
+
+			if (score == INT_MAX) break;
+		}
+
+		if (isStopped()) {
+			// out of budget: the last completed iteration is used, otherwise the search is discarded
+			if (!mOutOfBudget)
+				res_move = nullptr;
+			break;
+		}
+
+		GameUtils::Move *iterationMove = iterationCandidates.front().move;
+		int bestScore = iterationCandidates.front().score;
+		if (timeManager)
+			timeManager->onIteration(iteration > 0 && iterationMove != res_move);
+
+		resCandidates = std::move(iterationCandidates);
+		res_move = iterationMove;
+		mLastScore = (bestScore == INT_MAX || bestScore == INT_MIN) ? bestScore : bestScore + materialBalance(disposition);
+		mLastDepth = iteration + 1;
+		mTable.store(key, toTableScore(bestScore, 0), iteration + 1, TranspositionTable::BOUND_EXACT,
+		             res_move->from, res_move->to);
+		std::copy(resCandidates.front().pv.begin(), resCandidates.front().pv.end(), mLastPv.begin());
+		mLastPvLength = static_cast<int>(resCandidates.front().pv.size());
+		if (mListener)
+			mListener->onIteration(toSearchLine(resCandidates.front(), disposition), mLastDepth);
+
+		if (bestScore == INT_MAX) break;
+
+		// the candidates are searched first in the next iteration, the best move first
+		for (auto candidate = resCandidates.rbegin(); candidate != resCandidates.rend(); candidate++) {
+			auto it = std::find(moves.begin(), moves.end(), candidate->move);
+			std::rotate(moves.begin(), it, it + 1);
+		}
+	}
+
+	mLastLines.clear();
+	for (const RootLine &candidate: resCandidates)
+		mLastLines.push_back(toSearchLine(candidate, disposition));
+
+	// weakening: the candidate with the best noisy score is played, a win is never missed
+	if (res_move && resCandidates.size() > 1 && limits.noise > 0) {
+		std::uniform_int_distribution noise(-limits.noise, limits.noise);
+		int bestScore = INT_MIN;
+		for (const RootLine &candidate: resCandidates) {
+			int score = candidate.score;
+			int noisyScore = (score == INT_MAX || score == INT_MIN) ? score : score + noise(mRandom);
+			if (noisyScore > bestScore || candidate.move == resCandidates.front().move) {
+				bestScore = noisyScore;
+				res_move = candidate.move;
+			}
+		}
+
+		// the principal variation starts with another move
+		if (res_move != resCandidates.front().move)
+			mLastPvLength = 0;
+	}
+
+	mStop = nullptr;
+	mTimeManager = nullptr;
+	for (GameUtils::Move *move: moves) {
+		if (move != res_move)
+			delete move;
+	}
+
+	return res_move;
+}
+
+std::vector<SearchLine> Engine::analyze(const GameUtils::Disposition &disposition, int lines, int depth,
+                                        const std::atomic<bool> *stop, TimeManager *timeManager) {
+	SearchLimits limits;
+	limits.depth = depth;
+	limits.candidates = lines;
+	delete calculateBestMove(disposition, limits, stop, timeManager);
+	return mLastLines;
+}
+
+const std::vector<SearchLine> &Engine::getLines() const {
+	return mLastLines;
+}
+
+void Engine::setSearchListener(SearchListener *listener) {
+	mListener = listener;
+}
+
+bool Engine::getPredictedReply(int &from, int &to) const {
+	if (mLastPvLength < 2) return false;
+
+	from = mLastPv[1].from;
+	to = mLastPv[1].to;
+	return true;
+}
+
+int Engine::minimax(const GameUtils::Disposition &disposition, int oldScore, bool maximizing, int depth, int ply,
+                    int alpha, int beta) {
+	mPvLength[ply] = ply;
+	mNodes++;
+	if (depth == 0) return oldScore + mEvaluator.evaluate(ply); // depth limit reached
+
+	if (mNodes >= mNextBudgetCheck) {
+		mNextBudgetCheck = mNodes + BUDGET_CHECK_NODES;
+		mOutOfBudget = (mTimeManager && mTimeManager->isHardLimitReached()) ||
+		               (mNodeLimit > 0 && mNodes >= mNodeLimit);
+	}
+	if (isStopped()) return oldScore; // search aborted
+
+	uint64_t key = GameUtils::hash(disposition, maximizing);
+	mKeys[mKeyBase + ply] = key;
+	if (isRepetition(ply)) return mDrawScore; // the branch would cycle
+
+	int ttFrom = -1, ttTo = -1;
+	const TranspositionTable::Entry *entry = mTable.probe(key);
+	if (entry) {
+		ttFrom = entry->from;
+		ttTo = entry->to;
+		if (entry->depth >= depth) {
+			int score = fromTableScore(entry->score, oldScore);
+			if (entry->bound == TranspositionTable::BOUND_EXACT ||
+			    (entry->bound == TranspositionTable::BOUND_LOWER && score >= beta) ||
+			    (entry->bound == TranspositionTable::BOUND_UPPER && score <= alpha))
+				return score;
+		}
+	}
+
+	int oldAlpha = alpha, oldBeta = beta;
+	int bestScore = maximizing ? INT_MIN : INT_MAX, score;
+	const GameUtils::Move *bestMove = nullptr;
+
+	size_t arenaMark = mArena.mark();
+	GameUtils::MoveList &moves = mMoves[ply];
+	if (!GameUtils::findMoves(disposition, !maximizing, moves, &mArena)) {
+		// the arena is full: the position is evaluated as a leaf
+		mArena.release(arenaMark);
+		return oldScore + mEvaluator.evaluate(ply);
+	}
+	orderMoves(disposition, moves, maximizing, ttFrom, ttTo);
+
+	// moves are reduced or pruned only if nothing can be eaten or promoted, those moves are always searched
+	bool quiet = mSelective && std::none_of(moves.begin(), moves.end(), [&](const GameUtils::Move *move) {
+		return materialGain(disposition, *move) > 0;
+	});
+	bool razoring = false;
+	if (quiet && depth <= std::max(FUTILITY_DEPTH, RAZOR_DEPTH)) {
+		int staticScore = oldScore + mEvaluator.evaluate(ply);
+
+		// futility pruning: a quiet move cannot bring the score back into the window
+		int margin = FUTILITY_MARGIN * depth;
+		if (depth <= FUTILITY_DEPTH && !moves.empty() &&
+		    (maximizing ? staticScore + margin <= alpha : staticScore - margin >= beta)) {
+			mArena.release(arenaMark);
+			return maximizing ? staticScore + margin : staticScore - margin;
+		}
+
+		// razoring: the moves are evaluated as leaves first, the node is searched only if one of them
+		// reaches the window
+		razoring = depth > 1 && depth <= RAZOR_DEPTH && !moves.empty() &&
+		           (maximizing ? staticScore + RAZOR_MARGIN <= alpha : staticScore - RAZOR_MARGIN >= beta);
+	}
+
+	// the children are leaves: they are evaluated together instead of visiting them one by one
+	bool frontier = depth == 1;
+	if (frontier || razoring) {
+		mLeafScores.resize(moves.size());
+		mEvaluator.evaluateMoves(ply, disposition, moves, mLeafScores.data());
+		mNodes += moves.size();
+		mPvLength[ply + 1] = ply + 1;
+	}
+
+	if (razoring) {
+		int razorScore = maximizing ? INT_MIN : INT_MAX;
+		for (size_t i = 0; i < moves.size(); i++) {
+			int gain = materialGain(disposition, *moves[i]);
+			int leafScore = (maximizing ? oldScore + gain : oldScore - gain) + mLeafScores[i];
+			razorScore = maximizing ? std::max(razorScore, leafScore) : std::min(razorScore, leafScore);
+		}
+
+		if (maximizing ? razorScore <= alpha : razorScore >= beta) {
+			mArena.release(arenaMark);
+			return razorScore;
+		}
+	}
+
+	for (size_t i = 0; i < moves.size(); i++) {
+		GameUtils::Move *move = moves[i];
+		bool cutoff = false;
+		int gain = materialGain(disposition, *move);
+		int childScore = maximizing ? oldScore + gain : oldScore - gain;
+		if (frontier) {
+			score = childScore + mLeafScores[i];
+		} else {
+			mRepetitionStart[ply + 1] = isIrreversible(disposition, *move) ? mKeyBase + ply + 1 : mRepetitionStart[ply];
+			mEvaluator.makeMove(ply, disposition, move->disposition);
+
+			// late move reduction: the move is searched again at full depth if it reaches the window
+			bool reduced = quiet && depth >= LMR_MIN_DEPTH && i >= LMR_MIN_MOVES;
+			if (reduced) {
+				score = minimax(move->disposition, childScore, !maximizing, depth - 1 - LMR_REDUCTION, ply + 1,
+				                alpha, beta);
+				reduced = maximizing ? score <= alpha : score >= beta;
+			}
+
+			if (!reduced)
+				score = minimax(move->disposition, childScore, !maximizing, depth - 1, ply + 1, alpha, beta);
+		}
+
+		if (maximizing) {
+			if (score > bestScore) {
+				bestScore = score;
+				bestMove = move;
+				updatePv(ply, move);
+
+				if (score > alpha) {
+					alpha = score;
+					cutoff = beta <= alpha;
+				}
+			}
+		} else {
+			if (score < bestScore) {
+				bestScore = score;
+				bestMove = move;
+				updatePv(ply, move);
+
+				if (score < beta) {
+					beta = score;
+					cutoff = beta <= alpha;
+				}
+			}
+		}
+
+		if (cutoff) {
+			// ignore other moves because parent won't choose this path
+			if (gain == 0)
+				mHistory[maximizing][move->from][move->to] += depth * depth;
+			break;
+		}
+	}
+
+	if (!isStopped()) {
+		// without moves the score is exact
+		TranspositionTable::Bound bound = TranspositionTable::BOUND_EXACT;
+		if (!moves.empty() && bestScore <= oldAlpha)
+			bound = TranspositionTable::BOUND_UPPER;
+		else if (!moves.empty() && bestScore >= oldBeta)
+			bound = TranspositionTable::BOUND_LOWER;
+
+		mTable.store(key, toTableScore(bestScore, oldScore), depth, bound,
+		             bestMove ? bestMove->from : -1, bestMove ? bestMove->to : -1);
+	}
+
+	mArena.release(arenaMark);
+	return bestScore;
+}
+
+void Engine::orderMoves(const GameUtils::Disposition &disposition, GameUtils::MoveList &moves, bool maximizing,
+                        int ttFrom, int ttTo) const {
+	auto rank = [&](const GameUtils::Move *move) {
+		if (move->from == ttFrom && move->to == ttTo) return INT_MAX;
+		if (int gain = materialGain(disposition, *move); gain > 0) return INT_MAX / 2 + gain;
+		return mHistory[maximizing][move->from][move->to];
+	};
+
+	std::stable_sort(moves.begin(), moves.end(), [&](const GameUtils::Move *a, const GameUtils::Move *b) {
+		return rank(a) > rank(b);
+	});
+}
+
+void Engine::updatePv(int ply, const GameUtils::Move *move) {
+	mPv[ply][ply] = MoveRef{static_cast<int8_t>(move->from), static_cast<int8_t>(move->to)};
+	int length = std::max(mPvLength[ply + 1], ply + 1);
+	std::copy(mPv[ply + 1].begin() + ply + 1, mPv[ply + 1].begin() + length, mPv[ply].begin() + ply + 1);
+	mPvLength[ply] = length;
+}
+
+SearchLine Engine::toSearchLine(const RootLine &candidate, const GameUtils::Disposition &disposition) {
+	SearchLine line;
+	line.from = candidate.move->from;
+	line.to = candidate.move->to;
+	line.disposition = candidate.move->disposition;
+	line.score = (candidate.score == INT_MAX || candidate.score == INT_MIN) ? candidate.score
+	             : candidate.score + materialBalance(disposition);
+	for (const MoveRef &ref: candidate.pv)
+		line.pv.emplace_back(ref.from, ref.to);
+
+	return line;
+}
+
+bool Engine::isRepetition(int ply) const {
+	int index = mKeyBase + ply;
+
+	// the same side moves every 2 plies
+	for (int i = index - 2; i >= mRepetitionStart[ply]; i -= 2) {
+		if (mKeys[i] == mKeys[index])
+			return true;
+	}
+
+	return false;
+}
+
+bool Engine::isStopped() const {
+	return mOutOfBudget || (mStop && mStop->load(std::memory_order_relaxed));
+}
@@ -0,0 +1,307 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/Evaluator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define EVALUATOR_X86
+#endif
+
+static_assert(sizeof(GameUtils::PieceType) == sizeof(int32_t), "the vector code reads pieces as 32-bit integers");
+
+/**
+ * Default bonus of a PC's piece on a square
+ */
+static constexpr int32_t pcBonus(bool dame, int position) {
+	int row = position / 8, col = position % 8;
+	if (dame) {
+		// a dame in the center controls both diagonals
+		int centerDistance = (row < 4 ? 3 - row : row - 4) + (col < 4 ? 3 - col : col - 4);
+		return 16 - 2 * centerDistance;
+	}
+
+	// pawns gain value as they get closer to promotion, the back row defends from the player's dames
+	constexpr int32_t rowBonus[8] = {6, 0, 3, 6, 10, 15, 22, 0};
+	int32_t bonus = rowBonus[row];
+	if (col >= 2 && col <= 5) bonus += 2;
+	return bonus;
+}
+
+/**
+ * @return The position of a dark square on the chessboard, as in GameHistory
+ */
+static constexpr int toPosition(int square) {
+	return square * 2 + (square / 4) % 2;
+}
+
+/**
+ * @return True if a pawn that promotes is always worth more than before, wherever the new dame is
+ */
+static constexpr bool isPromotionRewarded() {
+	int32_t maxPawn = INT32_MIN, minDame = INT32_MAX;
+	for (int square = 0; square < 32; square++) {
+		maxPawn = std::max(maxPawn, pcBonus(false, toPosition(square)));
+		minDame = std::min(minDame, pcBonus(true, toPosition(square)));
+	}
+
+	return DAME_SCORE + minDame > PAWN_SCORE + maxPawn && minDame >= 0;
+}
+
+static_assert(isPromotionRewarded(), "the default dame bonus must not discourage the promotion");
+
+static int evaluateScalar(const Evaluator::Tables &tables, const GameUtils::Disposition &disposition) {
+	int score = 0;
+	for (int position = 0; position < 64; position++)
+		score += tables[disposition[position]][position];
+
+	return score;
+}
+
+/**
+ * @return The bonus of a square in after minus the one in before
+ */
+static inline int squareDelta(const Evaluator::Tables &tables, const GameUtils::Disposition &before,
+                              const GameUtils::Disposition &after, int position) {
+	return tables[after[position]][position] - tables[before[position]][position];
+}
+
+/**
+ * Comparing the squares one by one is slower than looking up all of them
+ */
+static int childScalar(const Evaluator::Tables &tables, const GameUtils::Disposition &, int,
+                       const GameUtils::Disposition &after) {
+	return evaluateScalar(tables, after);
+}
+
+#ifdef EVALUATOR_X86
+/**
+ * A move changes a few squares: groups of squares are compared at once and only the changed
+ * squares are looked up in the tables
+ */
+__attribute__((target("sse2")))
+static int childSse2(const Evaluator::Tables &tables, const GameUtils::Disposition &before, int score,
+                     const GameUtils::Disposition &after) {
+	for (int position = 0; position < 64; position += 4) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&before[position]));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&after[position]));
+		unsigned changed = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))) & 0xF;
+		for (; changed; changed &= changed - 1)
+			score += squareDelta(tables, before, after, position + __builtin_ctz(changed));
+	}
+
+	return score;
+}
+
+__attribute__((target("avx2")))
+static int childAvx2(const Evaluator::Tables &tables, const GameUtils::Disposition &before, int score,
+                     const GameUtils::Disposition &after) {
+	// one bit for each square that changed
+	uint64_t changed = 0;
+	for (int position = 0; position < 64; position += 8) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&before[position]));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&after[position]));
+		uint64_t equal = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))));
+		changed |= (~equal & 0xFF) << position;
+	}
+
+	for (; changed; changed &= changed - 1)
+		score += squareDelta(tables, before, after, __builtin_ctzll(changed));
+
+	return score;
+}
+#endif
+
+Evaluator::Evaluator(int plies, Instructions maximum) : mInstructions(INSTRUCTIONS_SCALAR),
+                                                       mEvaluateChild(childScalar),
+                                                       mNetwork(maximum >= INSTRUCTIONS_AVX2),
+                                                       mScores(plies), mAccumulators(plies) {
+	setWeights(getDefaultWeights());
+
+#ifdef EVALUATOR_X86
+	__builtin_cpu_init();
+	if (maximum >= INSTRUCTIONS_AVX2 && __builtin_cpu_supports("avx2")) {
+		mInstructions = INSTRUCTIONS_AVX2;
+		mEvaluateChild = childAvx2;
+	} else if (maximum >= INSTRUCTIONS_SSE2 && __builtin_cpu_supports("sse2")) {
+		mInstructions = INSTRUCTIONS_SSE2;
+		mEvaluateChild = childSse2;
+	}
+#else
+	(void) maximum;
+#endif
+}
+
+Evaluator::Instructions Evaluator::getInstructions() const {
+	return mInstructions;
+}
+
+Evaluator::Weights Evaluator::getDefaultWeights() {
+	Weights weights{};
+	for (int square = 0; square < 32; square++) {
+		weights.pawn[square] = pcBonus(false, toPosition(square));
+		weights.dame[square] = pcBonus(true, toPosition(square));
+	}
+
+	return weights;
+}
+
+/**
+ * Reads the 32 values of a table
+ */
+static bool parseTable(const std::string &value, std::array<int32_t, 32> &table) {
+	std::istringstream stream(value);
+	for (int32_t &bonus: table) {
+		if (!(stream >> bonus))
+			return false;
+	}
+
+	return (stream >> std::ws).eof();
+}
+
+bool Evaluator::readWeights(const std::string &path, Weights &weights) {
+	std::ifstream file(path);
+	if (!file) return false;
+
+	Weights read{};
+	bool pawn = false, dame = false;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+
+		size_t equals = line.find('=');
+		if (equals == std::string::npos) return false;
+
+		std::string key = line.substr(0, equals), value = line.substr(equals + 1);
+		if (key == "pawn")
+			pawn = parseTable(value, read.pawn);
+		else if (key == "dame")
+			dame = parseTable(value, read.dame);
+		else
+			return false;
+	}
+
+	if (!pawn || !dame) return false;
+
+	weights = read;
+	return true;
+}
+
+bool Evaluator::writeWeights(const std::string &path, const Weights &weights) {
+	std::ofstream file(path);
+	file << "# Bonus of the PC's pieces on the 32 dark squares, in the order of their positions\n";
+	file << "# (the player's bonuses are the same with the chessboard rotated)\n";
+	for (const auto &[key, table]: {std::pair("pawn", &weights.pawn), std::pair("dame", &weights.dame)}) {
+		file << key << '=';
+		for (size_t square = 0; square < table->size(); square++)
+			file << (square ? " " : "") << (*table)[square];
+		file << '\n';
+	}
+
+	file.close();
+	return !file.fail();
+}
+
+bool Evaluator::loadWeights(const std::string &path) {
+	Weights weights;
+	if (!readWeights(path, weights))
+		return false;
+
+	setWeights(weights);
+	return true;
+}
+
+void Evaluator::setWeights(const Weights &weights) {
+	mWeights = weights;
+	for (auto &table: mTables)
+		table.fill(0);
+
+	// the player's pieces are the PC's ones with the chessboard rotated by 180 degrees
+	for (int square = 0; square < 32; square++) {
+		int position = toPosition(square);
+		mTables[GameUtils::PC_PAWN][position] = weights.pawn[square];
+		mTables[GameUtils::PC_DAME][position] = weights.dame[square];
+		mTables[GameUtils::PLAYER_PAWN][63 - position] = -weights.pawn[square];
+		mTables[GameUtils::PLAYER_DAME][63 - position] = -weights.dame[square];
+	}
+}
+
+const Evaluator::Weights &Evaluator::getWeights() const {
+	return mWeights;
+}
+
+bool Evaluator::loadNetwork(const std::string &path) {
+	if (!mNetwork.load(path))
+		return false;
+
+	mUseNetwork = true;
+	return true;
+}
+
+bool Evaluator::hasNetwork() const {
+	return mUseNetwork;
+}
+
+int Evaluator::evaluate(const GameUtils::Disposition &disposition) const {
+	if (mUseNetwork) {
+		Network::Accumulator accumulator;
+		mNetwork.refresh(disposition, accumulator);
+		return mNetwork.evaluate(accumulator);
+	}
+
+	return evaluateScalar(mTables, disposition);
+}
+
+void Evaluator::setRoot(const GameUtils::Disposition &disposition) {
+	if (mUseNetwork)
+		mNetwork.refresh(disposition, mAccumulators[0]);
+	else
+		mScores[0] = evaluateScalar(mTables, disposition);
+}
+
+void Evaluator::makeMove(int ply, const GameUtils::Disposition &before, const GameUtils::Disposition &after) {
+	if (mUseNetwork)
+		mNetwork.update(mAccumulators[ply], before, after, mAccumulators[ply + 1]);
+	else
+		mScores[ply + 1] = mEvaluateChild(mTables, before, mScores[ply], after);
+}
+
+int Evaluator::evaluate(int ply) const {
+	return mUseNetwork ? mNetwork.evaluate(mAccumulators[ply]) : mScores[ply];
+}
+
+void Evaluator::evaluateMoves(int ply, const GameUtils::Disposition &disposition, const GameUtils::MoveList &moves,
+                              int *scores) const {
+	if (mUseNetwork) {
+		Network::Accumulator accumulator;
+		for (size_t i = 0; i < moves.size(); i++) {
+			mNetwork.update(mAccumulators[ply], disposition, moves[i]->disposition, accumulator);
+			scores[i] = mNetwork.evaluate(accumulator);
+		}
+		return;
+	}
+
+	// the function is chosen once for the whole batch
+	EvaluateChildFunction evaluateChild = mEvaluateChild;
+	for (size_t i = 0; i < moves.size(); i++)
+		scores[i] = evaluateChild(mTables, disposition, mScores[ply], moves[i]->disposition);
+}
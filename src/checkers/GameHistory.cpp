@@ -0,0 +1,163 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/GameHistory.h"
+#include <algorithm>
+
+void GameHistory::reset(const GameUtils::Disposition &disposition, bool pcTurn) {
+	Ply ply = pack(disposition);
+	ply.hash = GameUtils::hash(disposition, pcTurn);
+	ply.pcTurn = pcTurn;
+
+	mPlies.assign(1, ply);
+	mCurrent = 0;
+}
+
+void GameHistory::push(const GameUtils::Disposition &disposition, int from, int to) {
+	const Ply &previous = mPlies[mCurrent];
+	Ply ply = pack(disposition);
+	ply.hash = GameUtils::updateHash(previous.hash, getDisposition(mCurrent), disposition);
+	ply.pcTurn = !previous.pcTurn;
+	ply.from = static_cast<int8_t>(from);
+	ply.to = static_cast<int8_t>(to);
+
+	// the pieces that disappeared, the moved one is the only one that can change square
+	uint32_t fromBit = 1u << (from / 2);
+	ply.eaten = (previous.pc | previous.player) & ~(ply.pc | ply.player) & ~fromBit;
+
+	bool pawnMove = !(previous.dames & fromBit);
+	ply.quietPlies = (ply.eaten || pawnMove) ? 0 : std::min(previous.quietPlies + 1, UINT8_MAX);
+
+	mPlies.resize(++mCurrent);
+	mPlies.push_back(ply);
+}
+
+bool GameHistory::goTo(size_t ply) {
+	if (ply >= mPlies.size()) return false;
+
+	mCurrent = ply;
+	return true;
+}
+
+size_t GameHistory::getCurrent() const {
+	return mCurrent;
+}
+
+size_t GameHistory::size() const {
+	return mPlies.size();
+}
+
+const GameHistory::Ply &GameHistory::getPly(size_t ply) const {
+	return mPlies[ply];
+}
+
+GameUtils::Disposition GameHistory::getDisposition(size_t index) const {
+	const Ply &ply = mPlies[index];
+	return unpack(ply.pc, ply.player, ply.dames);
+}
+
+GameUtils::Disposition GameHistory::unpack(uint32_t pc, uint32_t player, uint32_t dames) {
+	GameUtils::Disposition disposition{};
+
+	for (int square = 0; square < 32; square++) {
+		uint32_t bit = 1u << square;
+		bool dame = dames & bit;
+		if (pc & bit)
+			disposition[toPosition(square)] = dame ? GameUtils::PC_DAME : GameUtils::PC_PAWN;
+		else if (player & bit)
+			disposition[toPosition(square)] = dame ? GameUtils::PLAYER_DAME : GameUtils::PLAYER_PAWN;
+	}
+
+	return disposition;
+}
+
+std::vector<int> GameHistory::getEaten(size_t ply) const {
+	std::vector<int> eaten;
+	for (int square = 0; square < 32; square++) {
+		if (mPlies[ply].eaten & (1u << square))
+			eaten.push_back(toPosition(square));
+	}
+
+	return eaten;
+}
+
+int GameHistory::countRepetitions(size_t ply) const {
+	const uint64_t hash = mPlies[ply].hash;
+	int count = 1;
+
+	// the same side moves every 2 plies
+	for (size_t distance = 2; distance <= mPlies[ply].quietPlies; distance += 2) {
+		if (mPlies[ply - distance].hash == hash)
+			count++;
+	}
+
+	return count;
+}
+
+bool GameHistory::isDraw(size_t ply) const {
+	return mPlies[ply].quietPlies >= DRAW_QUIET_PLIES || countRepetitions(ply) >= DRAW_REPETITIONS;
+}
+
+std::vector<uint64_t> GameHistory::getReversibleKeys(size_t ply) const {
+	std::vector<uint64_t> keys;
+	keys.reserve(mPlies[ply].quietPlies + 1);
+	for (size_t i = ply - mPlies[ply].quietPlies; i <= ply; i++)
+		keys.push_back(mPlies[i].hash);
+
+	return keys;
+}
+
+std::vector<uint64_t> GameHistory::getFlippedReversibleKeys(size_t ply) const {
+	std::vector<uint64_t> keys;
+	keys.reserve(mPlies[ply].quietPlies + 1);
+	for (size_t i = ply - mPlies[ply].quietPlies; i <= ply; i++)
+		keys.push_back(GameUtils::hash(GameUtils::flip(getDisposition(i)), !mPlies[i].pcTurn));
+
+	return keys;
+}
+
+GameHistory::Ply GameHistory::pack(const GameUtils::Disposition &disposition) {
+	Ply ply{0, 0, 0, 0, 0, -1, -1, false, 0};
+
+	// the pieces are only on the dark squares, where position / 2 is unique
+	for (int position = 0; position < 64; position++) {
+		uint32_t bit = 1u << (position / 2);
+		switch (disposition[position]) {
+			case GameUtils::PC_DAME:
+				ply.dames |= bit;
+				[[fallthrough]];
+			case GameUtils::PC_PAWN:
+				ply.pc |= bit;
+				break;
+			case GameUtils::PLAYER_DAME:
+				ply.dames |= bit;
+				[[fallthrough]];
+			case GameUtils::PLAYER_PAWN:
+				ply.player |= bit;
+				break;
+			case GameUtils::EMPTY:
+				break;
+		}
+	}
+
+	return ply;
+}
+
+int GameHistory::toPosition(int square) {
+	// the dark square of each pair of columns is the first one in even rows
+	return square * 2 + (square / 4) % 2;
+}
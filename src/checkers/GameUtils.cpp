@@ -16,27 +16,32 @@
 */
 
 #include "checkers/GameUtils.h"
+#include "checkers/MoveArena.h"
 
 #include <algorithm>
-#include <climits>
-#include <random>
 #include <vector>
 
 GameUtils::MoveList GameUtils::findMoves(const Disposition &disposition, bool player) {
 	MoveList moves;
+	findMoves(disposition, player, moves, nullptr);
+	return moves;
+}
+
+bool GameUtils::findMoves(const Disposition &disposition, bool player, MoveList &moves, MoveArena *arena) {
+	moves.clear();
 
 	if (player) {
 		for (int position = 0; position < 64; position++) {
 			switch (disposition[position]) {
 				case PLAYER_DAME:
-					addMoveStep(moves, disposition, position, true, false, 0);
-					addMoveStep(moves, disposition, position, true, true, 0);
-					addMoveStep(moves, disposition, position, false, false, 0);
-					addMoveStep(moves, disposition, position, false, true, 0);
+					addMoveStep(moves, arena, disposition, position, position, true, false, 0);
+					addMoveStep(moves, arena, disposition, position, position, true, true, 0);
+					addMoveStep(moves, arena, disposition, position, position, false, false, 0);
+					addMoveStep(moves, arena, disposition, position, position, false, true, 0);
 					break;
 				case PLAYER_PAWN:
-					addMoveStep(moves, disposition, position, false, false, 0);
-					addMoveStep(moves, disposition, position, false, true, 0);
+					addMoveStep(moves, arena, disposition, position, position, false, false, 0);
+					addMoveStep(moves, arena, disposition, position, position, false, true, 0);
 					break;
 				case EMPTY:
 				case PC_PAWN:
@@ -48,14 +53,14 @@ GameUtils::MoveList GameUtils::findMoves(const Disposition &disposition, bool pl
 		for (int position = 0; position < 64; position++) {
 			switch (disposition[position]) {
 				case PC_DAME:
-					addMoveStep(moves, disposition, position, false, false, 0);
-					addMoveStep(moves, disposition, position, false, true, 0);
-					addMoveStep(moves, disposition, position, true, false, 0);
-					addMoveStep(moves, disposition, position, true, true, 0);
+					addMoveStep(moves, arena, disposition, position, position, false, false, 0);
+					addMoveStep(moves, arena, disposition, position, position, false, true, 0);
+					addMoveStep(moves, arena, disposition, position, position, true, false, 0);
+					addMoveStep(moves, arena, disposition, position, position, true, true, 0);
 					break;
 				case PC_PAWN:
-					addMoveStep(moves, disposition, position, true, false, 0);
-					addMoveStep(moves, disposition, position, true, true, 0);
+					addMoveStep(moves, arena, disposition, position, position, true, false, 0);
+					addMoveStep(moves, arena, disposition, position, position, true, true, 0);
 					break;
 				case EMPTY:
 				case PLAYER_PAWN:
@@ -65,27 +70,22 @@ GameUtils::MoveList GameUtils::findMoves(const Disposition &disposition, bool pl
 		}
 	}
 
-	// if there is a move with score > 0 then it deletes the non-eating moves
-	for (Move *move: moves) {
-		// if a pawn can eat something, moves that eat nothing are removed from the list
-		if (move->eatenFromPawn) {
-			MoveList new_moves;
-			for (Move *int_move: moves) {
-				if (int_move->score > 0) {
-					new_moves.push_back(int_move);
-				} else {
-					delete int_move;
-				}
-			}
-			return new_moves;
-		}
+	// if a pawn can eat something, moves that eat nothing are removed from the list
+	if (std::any_of(moves.begin(), moves.end(), [](const Move *move) { return move->eatenFromPawn; })) {
+		std::erase_if(moves, [arena](Move *move) {
+			if (move->score > 0)
+				return false;
+			if (!arena)
+				delete move; // moves in the arena are freed with it
+			return true;
+		});
 	}
 
-	return moves;
+	return !arena || !arena->hasOverflowed();
 }
 
-bool GameUtils::addMoveStep(MoveList &moves, const Disposition &disposition, int source_position, bool row_offset,
-                            bool col_offset, int score) {
+bool GameUtils::addMoveStep(MoveList &moves, MoveArena *arena, const Disposition &disposition, int from, int source_position,
+                            bool row_offset, bool col_offset, int score) {
 	// invalid move (out of bounds)
 	if (source_position / 8 == (row_offset ? 7 : 0) || source_position % 8 == (col_offset ? 7 : 0))
 		return false;
@@ -106,7 +106,7 @@ bool GameUtils::addMoveStep(MoveList &moves, const Disposition &disposition, int
 			} else {
 				copy[position] = (position / 8 == 0 && source_value == PLAYER_PAWN) ? PLAYER_DAME : source_value;
 			}
-			moves.push_back(new Move(copy, false, 0));
+			addMove(moves, arena, copy, false, 0, from, position);
 			return true;
 		}
 		return false;
@@ -136,14 +136,14 @@ bool GameUtils::addMoveStep(MoveList &moves, const Disposition &disposition, int
 		}
 		score += PAWN_SCORE;
 
-		if (addMoveStep(moves, copy, jump_position, row_offset, false, score))
+		if (addMoveStep(moves, arena, copy, from, jump_position, row_offset, false, score))
 			isValid = false;
 
-		if (addMoveStep(moves, copy, jump_position, row_offset, true, score))
+		if (addMoveStep(moves, arena, copy, from, jump_position, row_offset, true, score))
 			isValid = false;
 
 		if (isValid)
-			moves.push_back(new Move(copy, true, score));
+			addMove(moves, arena, copy, true, score, from, jump_position);
 
 		return true;
 	}
@@ -164,122 +164,137 @@ bool GameUtils::addMoveStep(MoveList &moves, const Disposition &disposition, int
 	copy[jump_position] = source_value;
 	score += (mid_value == PC_DAME || mid_value == PLAYER_DAME ) ? DAME_SCORE : PAWN_SCORE;
 
-	if (addMoveStep(moves, copy, jump_position, row_offset, false, score))
+	if (addMoveStep(moves, arena, copy, from, jump_position, row_offset, false, score))
 		isValid = false;
 
-	if (addMoveStep(moves, copy, jump_position, row_offset, true, score))
+	if (addMoveStep(moves, arena, copy, from, jump_position, row_offset, true, score))
 		isValid = false;
 
-	if (addMoveStep(moves, copy, jump_position, !row_offset, false, score))
+	if (addMoveStep(moves, arena, copy, from, jump_position, !row_offset, false, score))
 		isValid = false;
 
-	if (addMoveStep(moves, copy, jump_position, !row_offset, true, score))
+	if (addMoveStep(moves, arena, copy, from, jump_position, !row_offset, true, score))
 		isValid = false;
 
 	if (isValid)
-		moves.push_back(new Move(copy, false, score));
+		addMove(moves, arena, copy, false, score, from, jump_position);
 
 	return true;
 }
 
-struct {
-	bool operator()(GameUtils::Move *a, GameUtils::Move *b) const { return a->score < b->score; }
-} sortAscending;
-
-struct {
-	bool operator()(GameUtils::Move *a, GameUtils::Move *b) const { return a->score > b->score; }
-} sortDiscending;
-
-GameUtils::Move *GameUtils::calculateBestMove(const GameUtils::Disposition &disposition, int depth) {
-	if (depth < 0) return nullptr;
-
-	GameUtils::Move *res_move = nullptr;
-	int bestScore = INT_MIN;
-	int alpha = INT_MIN, beta = INT_MAX;
-
-	std::vector<GameUtils::Move *> moves = GameUtils::findMoves(disposition, false);
-	std::shuffle(moves.begin(), moves.end(), std::random_device());
-	std::sort(moves.begin(), moves.end(), sortAscending);
-	for (GameUtils::Move *move: moves) {
-		int score = minimax(move, move->score, false, depth, alpha, beta);
-		if (score == INT_MAX) {
-			bestScore = INT_MAX;
-			res_move = move;
-			break;
-		}
+void GameUtils::addMove(MoveList &moves, MoveArena *arena, const Disposition &disposition, bool eatenFromPawn,
+                        int score, int from, int to) {
+	Move *move = arena ? arena->create(disposition, eatenFromPawn, score, from, to)
+	                   : new Move(disposition, eatenFromPawn, score, from, to);
+	if (move)
+		moves.push_back(move);
+}
 
-		if (score > bestScore) {
-			bestScore = score;
-			res_move = move;
-		}
+std::vector<int> GameUtils::findEaten(const Disposition &disposition, const Move &move) {
+	std::vector<int> eaten;
+	for (int position = 0; position < 64; position++) {
+		if (position != move.from && disposition[position] != EMPTY && move.disposition[position] == EMPTY)
+			eaten.push_back(position);
+	}
+
+	return eaten;
+}
+
+std::vector<int> GameUtils::findPath(const Disposition &disposition, const Move &move) {
+	std::vector<int> eaten = findEaten(disposition, move);
+	if (eaten.empty())
+		return {move.to};
+
+	std::vector<int> path;
+	std::vector<bool> jumped(eaten.size(), false);
+	addPathStep(path, disposition, move, eaten, jumped, move.from);
+	return path;
+}
+
+bool GameUtils::addPathStep(std::vector<int> &path, const Disposition &disposition, const Move &move,
+                            const std::vector<int> &eaten, std::vector<bool> &jumped, int position) {
+	if (position == move.to && std::all_of(jumped.begin(), jumped.end(), [](bool value) { return value; }))
+		return true;
 
-		if (score > alpha) {
-			alpha = score;
+	for (int rowOffset = -1; rowOffset <= 1; rowOffset += 2) {
+		for (int colOffset = -1; colOffset <= 1; colOffset += 2) {
+			int row = position / 8 + rowOffset * 2, col = position % 8 + colOffset * 2;
+			if (row < 0 || row > 7 || col < 0 || col > 7) continue;
+
+			auto it = std::find(eaten.begin(), eaten.end(), position + rowOffset * 8 + colOffset);
+			if (it == eaten.end() || jumped[it - eaten.begin()]) continue;
+
+			// the landing square is empty before the move or it is emptied by the move itself
+			int jumpPosition = row * 8 + col;
+			if (disposition[jumpPosition] != EMPTY && jumpPosition != move.from &&
+			    std::find(eaten.begin(), eaten.end(), jumpPosition) == eaten.end())
+				continue;
+
+			jumped[it - eaten.begin()] = true;
+			path.push_back(jumpPosition);
+			if (addPathStep(path, disposition, move, eaten, jumped, jumpPosition))
+				return true;
+
+			path.pop_back();
+			jumped[it - eaten.begin()] = false;
 		}
 	}
 
-	if (moves.empty()) {
-		return nullptr;
-	} else if (res_move == nullptr) {
-		// bestScore equals INT_MIN
-		res_move = moves.front();
+	return false;
+}
+
+// Zobrist keys, generated at compile time with splitmix64 so that hashes are stable across runs
+static constexpr uint64_t splitmix64(uint64_t &state) {
+	uint64_t z = (state += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+static constexpr auto zobristKeys = [] {
+	std::array<std::array<uint64_t, 64>, 5> keys{};
+	uint64_t state = 0x1ce4e5b9;
+	for (int piece = GameUtils::PC_PAWN; piece <= GameUtils::PLAYER_DAME; piece++) {
+		for (int position = 0; position < 64; position++)
+			keys[piece][position] = splitmix64(state);
 	}
+	return keys;
+}();
+
+static constexpr uint64_t zobristPcTurn = 0x7c15b7d2d1a4f3e9;
 
-	for (GameUtils::Move *move: moves) {
-		if (move != res_move)
-			delete move;
+uint64_t GameUtils::hash(const Disposition &disposition, bool pcTurn) {
+	uint64_t key = pcTurn ? zobristPcTurn : 0;
+	for (int position = 0; position < 64; position++) {
+		if (disposition[position] != EMPTY)
+			key ^= zobristKeys[disposition[position]][position];
 	}
 
-	return res_move;
+	return key;
 }
 
-int GameUtils::minimax(const GameUtils::Move *start_move, int oldScore, bool maximizing, int depth, int alpha,
-                           int beta) {
-	if (depth == 0) return oldScore; // depth limit reached
-
-	int bestScore, score;
-
-	if (maximizing) {
-		bestScore = INT_MIN;
-		std::vector<GameUtils::Move *> moves = GameUtils::findMoves(start_move->disposition, false);
-		std::sort(moves.begin(), moves.end(), sortAscending);
-		for (GameUtils::Move *move: moves) {
-			score = minimax(move, oldScore + move->score, false, depth - 1, alpha, beta);
-			if (score > bestScore) {
-				bestScore = score;
-
-				if (score > alpha) {
-					alpha = score;
-					if (beta <= alpha)
-						break; // ignore other moves because parent won't choose this path
-				}
-			}
-		}
-
-		for (GameUtils::Move *move: moves) {
-			delete move;
-		}
-		return bestScore;
+uint64_t GameUtils::updateHash(uint64_t key, const Disposition &before, const Disposition &after) {
+	key ^= zobristPcTurn;
+	for (int position = 0; position < 64; position++) {
+		// the keys of the empty squares are 0
+		if (before[position] != after[position])
+			key ^= zobristKeys[before[position]][position] ^ zobristKeys[after[position]][position];
 	}
 
-	bestScore = INT_MAX;
-	std::vector<GameUtils::Move *> moves = GameUtils::findMoves(start_move->disposition, true);
-	std::sort(moves.begin(), moves.end(), sortDiscending);
-	for (GameUtils::Move *move: moves) {
-		score = minimax(move, oldScore - move->score, true, depth - 1, alpha, beta);
-		if (score < bestScore) {
-			bestScore = score;
-
-			if (score < beta) {
-				beta = score;
-				if (beta <= alpha)
-					break; // ignore other moves because parent won't choose this path
-			}
+	return key;
+}
+
+GameUtils::Disposition GameUtils::flip(const Disposition &disposition) {
+	Disposition flipped{};
+	for (int position = 0; position < 64; position++) {
+		switch (disposition[63 - position]) {
+			case PC_PAWN: flipped[position] = PLAYER_PAWN; break;
+			case PC_DAME: flipped[position] = PLAYER_DAME; break;
+			case PLAYER_PAWN: flipped[position] = PC_PAWN; break;
+			case PLAYER_DAME: flipped[position] = PC_DAME; break;
+			case EMPTY: break;
 		}
 	}
 
-	for (GameUtils::Move *move: moves) {
-		delete move;
-	}
-	return bestScore;
+	return flipped;
 }
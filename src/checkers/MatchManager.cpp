@@ -16,27 +16,189 @@
 */
 
 #include "checkers/MatchManager.h"
+#include <algorithm>
+#include <climits>
 #include <iostream>
+#include <numeric>
 #include <vector>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+// the hint is searched at a lower priority than the PC's searches
+#define HINT_NICE 10
+
+
+/**
+ * Search of each difficulty: the node budget doubles at each level and bounds the time of a move,
+ * the weakening fades out until the last levels play the best move
+ */
+static const SearchLimits DIFFICULTY_LIMITS[DEF_MAX_GD - DEF_MIN_GD + 1] = {
+	// depth, nodes, candidates, noise, blunderPercent
+	{0, 1000, 4, 150, 30},
+	{1, 2000, 4, 120, 25},
+	{2, 4000, 4, 100, 20},
+	{3, 8000, 3, 80, 15},
+	{4, 16000, 3, 60, 12},
+	{5, 32000, 3, 45, 9},
+	{6, 64000, 2, 30, 6},
+	{7, 128000, 2, 20, 4},
+	{8, 256000, 2, 12, 2},
+	{9, 512000, 2, 6, 1},
+	{12, 1000000, 1, 0, 0},
+	{16, 2000000, 1, 0, 0},
+	{MAX_DEPTH, 4000000, 1, 0, 0},
+};
+
+/**
+ * @return The configuration of the engine that searches the hints, it uses a smaller table
+ */
+static EngineConfig hintConfig(EngineConfig config) {
+	config.ttSize /= 4;
+	return config;
+}
+
+MatchManager::MatchManager(const EngineConfig &engineConfig) : mEngine(engineConfig),
+                                                               mHintEngine(hintConfig(engineConfig)) {
+	mHintEngine.setSearchListener(&mHintListener);
+
+	// the other members are ready before the thread starts
+	mMatchThread = std::thread(&MatchManager::run, this);
+}
+
+SearchLimits MatchManager::getDifficultyLimits(int difficulty) {
+	return DIFFICULTY_LIMITS[std::clamp(difficulty, minGD, maxGD) - minGD];
+}
+
 MatchManager::~MatchManager() {
+	// the PC's search is aborted so the thread reads QUIT without finishing it, the abort is never cleared
+	mQueuedAborts++;
+	mStopSearch = true;
+	mCommands.push(Command{});
+	mMatchThread.join();
+	takePonderedReply(nullptr);
+
 	for (GameUtils::Move *move: mMoves) {
 		delete move;
 	}
 }
 
+bool MatchManager::BoardDelta::isEmpty() const {
+	return pieces.empty() && possibleMoves.empty() && selected == selectedNone && !clear;
+}
+
+void MatchManager::BoardDelta::merge(const BoardDelta &other) {
+	if (other.clear) {
+		// the highlights of this delta are removed anyway
+		clear = true;
+		possibleMoves.clear();
+		selected = selectedNone;
+	}
+
+	pieces.insert(pieces.end(), other.pieces.begin(), other.pieces.end());
+	possibleMoves.insert(possibleMoves.end(), other.possibleMoves.begin(), other.possibleMoves.end());
+	if (other.selected != selectedNone)
+		selected = other.selected;
+}
+
 void MatchManager::addEventListener(EventListener *listener) {
+	std::lock_guard<std::mutex> lock(mListenersMutex);
 	mListeners.push_back(listener);
 }
 
 void MatchManager::removeEventListener(EventListener *listener) {
+	std::lock_guard<std::mutex> lock(mListenersMutex);
 	std::erase(mListeners, listener);
 }
 
-void MatchManager::squareClick(int currentPos) {
-	if (!mIsPlaying) return;
+void MatchManager::run() {
+	Command command;
+	while (true) {
+		mCommands.waitPop(command);
+		if (command.type == Command::QUIT) return;
+
+		execute(command);
+		publishHistory();
+	}
+}
+
+void MatchManager::pushAborting(const Command &command) {
+	mQueuedAborts++;
+	mStopSearch = true;
+	mCommands.push(command);
+}
+
+void MatchManager::clearAbort() {
+	if (--mQueuedAborts > 0) return;
 
+	// a command queued meanwhile sets the flag again, after incrementing the counter
+	mStopSearch = false;
+	if (mQueuedAborts > 0)
+		mStopSearch = true;
+}
+
+void MatchManager::execute(const Command &command) {
+	switch (command.type) {
+		case Command::CLICK:
+			if (!mIsPlaying) return;
+			processClick(static_cast<int>(command.value));
+			flushBoard();
+			break;
+		case Command::NEW_MATCH:
+			clearAbort();
+			processNewMatch(static_cast<int>(command.value), command.isPcFirstPlayer);
+			break;
+		case Command::UNDO:
+			clearAbort();
+			processUndo();
+			break;
+		case Command::REDO:
+			clearAbort();
+			processRedo();
+			break;
+		case Command::GO_TO_PLY:
+			clearAbort();
+			processGoToPly(static_cast<size_t>(command.value));
+			break;
+		case Command::TIME_CONTROL:
+			mTimeControl = std::max(command.value, 0L);
+			mIncrement = std::max(command.increment, 0L);
+			mMovesToGo = std::max(command.movesToGo, 0);
+			break;
+		case Command::HINT:
+			// the PC moves while executing a command, so the player moves next
+			if (mIsPlaying && !mHintThread.joinable()) startHint();
+			break;
+		case Command::STOP:
+			clearAbort();
+			takePonderedReply(nullptr);
+			mIsPlaying = false;
+			break;
+		case Command::QUIT:
+			break;
+	}
+}
+
+void MatchManager::publishHistory() {
+	size_t ply;
+	mPlyCount = mHistory.size();
+	mCanUndo = findUndoPly(ply);
+	mCanRedo = findRedoPly(ply);
+}
+
+void MatchManager::squareClick(int index) {
+	if (index < 0 || index > 63) return;
+
+	Command command;
+	command.type = Command::CLICK;
+	command.value = index;
+	mCommands.push(command);
+}
+
+void MatchManager::processClick(int currentPos) {
 	if (mSelectedPos == selectedNone) {
 		if ((mDisposition[currentPos] == GameUtils::PLAYER_PAWN ||
 			mDisposition[currentPos] == GameUtils::PLAYER_DAME)) {
@@ -89,36 +251,218 @@ void MatchManager::squareClick(int currentPos) {
 	}
 
 	// legal move
+	GameUtils::Move *pcMove = takePonderedReply(move);
 	mDisposition = move->disposition;
-	updateDisposition(&mDisposition);
+	mHistory.push(mDisposition, move->from, move->to);
+	updateDisposition();
 	mSelectedPos = selectedNone;
 
-	makePCMove();
+	if (checkDraw()) {
+		delete pcMove;
+		return;
+	}
+
+	makePCMove(pcMove);
 }
 
 bool MatchManager::newMatch(int newDifficulty, bool isPcFirstPlayer) {
 	if (newDifficulty < minGD || newDifficulty > maxGD)
 		return false;
+
+	Command command;
+	command.type = Command::NEW_MATCH;
+	command.value = newDifficulty;
+	command.isPcFirstPlayer = isPcFirstPlayer;
+	pushAborting(command);
+	return true;
+}
+
+bool MatchManager::processNewMatch(int newDifficulty, bool isPcFirstPlayer) {
+	if (newDifficulty < minGD || newDifficulty > maxGD)
+		return false;
+	takePonderedReply(nullptr);
+	mEngine.newGame();
+	mHintEngine.newGame();
 	mGameDifficulty = newDifficulty;
+	mPcTime = mTimeControl;
+	mMovesLeft = mMovesToGo;
 
 	setDefaultLayout();
-	updateDisposition(&mDisposition);
+	mHistory.reset(mDisposition, isPcFirstPlayer);
+	updateDisposition();
 
 	mIsEnd = false;
 	mIsPlaying = true;
 	if (isPcFirstPlayer) {
 		makePCMove();
 	} else {
-		for (GameUtils::Move *move: mMoves) {
-			delete move;
-		}
-		mMoves = GameUtils::findMoves(mDisposition, true);
+		findPlayerMoves();
+		startPondering();
+		if (mHintEnabled) startHint();
 		changeState(TURN_PLAYER);
 	}
 
 	return true;
 }
 
+bool MatchManager::undo() {
+	if (!mCanUndo) return false;
+
+	Command command;
+	command.type = Command::UNDO;
+	pushAborting(command);
+	return true;
+}
+
+bool MatchManager::redo() {
+	if (!mCanRedo) return false;
+
+	Command command;
+	command.type = Command::REDO;
+	pushAborting(command);
+	return true;
+}
+
+bool MatchManager::goToPly(size_t ply) {
+	if (ply >= mPlyCount) return false;
+
+	Command command;
+	command.type = Command::GO_TO_PLY;
+	command.value = static_cast<long>(ply);
+	pushAborting(command);
+	return true;
+}
+
+void MatchManager::stop() {
+	Command command;
+	command.type = Command::STOP;
+	pushAborting(command);
+}
+
+bool MatchManager::findUndoPly(size_t &ply) const {
+	ply = mHistory.getCurrent();
+	if (ply == 0) return false;
+
+	// the PC's turns are skipped, the PC would move again
+	ply--;
+	if (!isPlayerPly(ply)) {
+		if (ply == 0) return false;
+		ply--;
+	}
+
+	return true;
+}
+
+bool MatchManager::findRedoPly(size_t &ply) const {
+	ply = mHistory.getCurrent() + 1;
+	if (ply >= mHistory.size()) return false;
+
+	if (!isPlayerPly(ply))
+		ply++;
+
+	return true;
+}
+
+bool MatchManager::processUndo() {
+	size_t ply;
+	if (!findUndoPly(ply)) return false;
+
+	restorePly(ply);
+	return true;
+}
+
+bool MatchManager::processRedo() {
+	size_t ply;
+	if (!findRedoPly(ply)) return false;
+
+	restorePly(ply);
+	return true;
+}
+
+bool MatchManager::processGoToPly(size_t ply) {
+	if (ply >= mHistory.size()) return false;
+
+	if (!isPlayerPly(ply))
+		ply++;
+
+	restorePly(ply);
+	return true;
+}
+
+const GameHistory &MatchManager::getHistory() const {
+	return mHistory;
+}
+
+size_t MatchManager::getPlyCount() const {
+	return mPlyCount;
+}
+
+bool MatchManager::isPlayerPly(size_t ply) const {
+	return !mHistory.getPly(ply).pcTurn || ply + 1 == mHistory.size();
+}
+
+bool MatchManager::checkDraw() {
+	if (!mHistory.isDraw(mHistory.getCurrent())) return false;
+
+	mIsEnd = true;
+	mIsPlaying = false;
+	changeState(DRAW);
+	return true;
+}
+
+void MatchManager::restorePly(size_t ply) {
+	takePonderedReply(nullptr);
+	mHistory.goTo(ply);
+	mDisposition = mHistory.getDisposition(ply);
+	updateDisposition();
+	mSelectedPos = selectedNone;
+
+	if (checkDraw()) return;
+
+	if (mHistory.getPly(ply).pcTurn) {
+		// the last ply, the PC could not move
+		mIsEnd = true;
+		mIsPlaying = false;
+		changeState(PLAYER_WON);
+		return;
+	}
+
+	findPlayerMoves();
+	if (mMoves.empty()) {
+		mIsEnd = true;
+		mIsPlaying = false;
+		changeState(PC_WON);
+		return;
+	}
+
+	mIsEnd = false;
+	mIsPlaying = true;
+	startPondering();
+	if (mHintEnabled) startHint();
+	changeState(TURN_PLAYER);
+}
+
+void MatchManager::setPonderMode(PonderMode mode) {
+	mPonderMode = mode;
+}
+
+MatchManager::PonderMode MatchManager::getPonderMode() const {
+	return mPonderMode;
+}
+
+void MatchManager::setTimeControl(long time, long increment, int movesToGo) {
+	Command command;
+	command.type = Command::TIME_CONTROL;
+	command.value = time;
+	command.increment = increment;
+	command.movesToGo = movesToGo;
+	mCommands.push(command);
+}
+
+long MatchManager::getPcTime() const {
+	return mPcTime;
+}
+
 int MatchManager::getDifficulty() const {
 	return mGameDifficulty;
 }
@@ -132,42 +476,82 @@ bool MatchManager::isEnd() const {
 }
 
 void MatchManager::changeState(State type) {
+	flushBoard(); // listeners see the chessboard of the new state
+
+	std::lock_guard<std::mutex> lock(mListenersMutex);
 	for (auto &listener : mListeners) {
 		listener->onStateChange(type);
 	}
 }
 
 void MatchManager::selectSquare(int index) {
-	for (auto &listener : mListeners) {
-		listener->onSquareSelected(index);
-	}
+	mPendingDelta.selected = index;
 }
 
-void MatchManager::makeSquarePossibleMove(int index) {
-	for (auto &listener : mListeners) {
-		listener->onSquarePossibleMove(index);
-	}
+void MatchManager::makeSquaresPossibleMove(const std::vector<int> &indexes) {
+	mPendingDelta.possibleMoves.insert(mPendingDelta.possibleMoves.end(), indexes.begin(), indexes.end());
 }
 
 void MatchManager::clearSquares() {
-	for (auto &listener : mListeners) {
-		listener->onSquareClear();
+	mPendingDelta.merge(BoardDelta{{}, {}, selectedNone, true});
+}
+
+void MatchManager::updateDisposition() {
+	clearSquares();
+	for (int i = 0; i < 64; i++) {
+		if (mShownDisposition[i] != mDisposition[i])
+			mPendingDelta.pieces.emplace_back(i, mDisposition[i]);
 	}
+	mShownDisposition = mDisposition;
 }
 
-void MatchManager::updateDisposition(GameUtils::Disposition *newDisposition) {
+void MatchManager::flushBoard() {
+	if (mPendingDelta.isEmpty()) return;
+
+	std::lock_guard<std::mutex> lock(mListenersMutex);
 	for (auto &listener : mListeners) {
-		listener->onUpdateDisposition(newDisposition);
+		listener->onBoardUpdate(mPendingDelta);
 	}
+	mPendingDelta = BoardDelta{};
 }
 
-void MatchManager::makePCMove() {
+void MatchManager::makePCMove(GameUtils::Move *pcMove) {
 	changeState(TURN_PC);
 #ifdef DEBUG
 	std::cerr << "Waiting 5 seconds for debug..." << std::endl;
 	sleep(5); // TODO: test delay
 #endif
-	auto *pcMove = GameUtils::calculateBestMove(mDisposition, mGameDifficulty);
+	long elapsed = 0;
+	bool searched = pcMove == nullptr;
+	if (searched) {
+		// the positions before the current one, which is the root of the search
+		std::vector<uint64_t> keys = mHistory.getReversibleKeys(mHistory.getCurrent());
+		keys.pop_back();
+		mEngine.setGameHistory(keys);
+	}
+
+	if (pcMove == nullptr && mTimeControl > 0) {
+		TimeManager timeManager;
+		timeManager.start(mPcTime, mIncrement, mMovesLeft);
+		pcMove = mEngine.calculateBestMove(mDisposition, MAX_DEPTH, &mStopSearch, &timeManager);
+		elapsed = timeManager.elapsed();
+	} else if (pcMove == nullptr) {
+		pcMove = mEngine.calculateBestMove(mDisposition, getDifficultyLimits(mGameDifficulty), &mStopSearch);
+	}
+
+	// otherwise the prediction was stored with the pondered reply
+	if (searched) {
+		mPredictedReply = {-1, -1};
+		mEngine.getPredictedReply(mPredictedReply.first, mPredictedReply.second);
+	}
+
+	// a queued command aborted the search, the match is paused until it is executed
+	if (mStopSearch) {
+		delete pcMove;
+		mIsPlaying = false;
+		return;
+	}
+
 	if (pcMove == nullptr) {
 		// PC cannot do anything, player won
 		mIsEnd = true;
@@ -177,14 +561,14 @@ void MatchManager::makePCMove() {
 	}
 
 	mDisposition = pcMove->disposition;
-	updateDisposition(&mDisposition);
+	mHistory.push(mDisposition, pcMove->from, pcMove->to);
+	updateDisposition();
 	delete pcMove;
+	updatePcClock(elapsed);
 
-	// deletes all moves before re-assignment
-	for (GameUtils::Move *move: mMoves)
-		delete move;
+	if (checkDraw()) return;
 
-	mMoves = GameUtils::findMoves(mDisposition, true);
+	findPlayerMoves();
 	if (mMoves.empty()) {
 		// Player cannot do anything, PC won
 		mIsEnd = true;
@@ -193,9 +577,155 @@ void MatchManager::makePCMove() {
 		return;
 	}
 
+	startPondering();
+	if (mHintEnabled) startHint();
 	changeState(TURN_PLAYER);
 }
 
+void MatchManager::updatePcClock(long elapsed) {
+	if (mTimeControl == 0) return;
+
+	long time = std::max(mPcTime - elapsed, 0L) + mIncrement;
+	if (mMovesToGo > 0 && --mMovesLeft == 0) {
+		// next time control
+		time += mTimeControl;
+		mMovesLeft = mMovesToGo;
+	}
+	mPcTime = time;
+}
+
+void MatchManager::startPondering() {
+	PonderMode mode = mPonderMode;
+	if (mode == PONDER_OFF || mMoves.empty()) return;
+
+	mPonderReplies.assign(mMoves.size(), nullptr);
+	mPonderPredictions.assign(mMoves.size(), {-1, -1});
+
+	// the roots are the positions after the player's moves, so the current one is included
+	mEngine.setGameHistory(mHistory.getReversibleKeys(mHistory.getCurrent()));
+
+	// the predicted reply is the one of the principal variation, otherwise the one that eats the most
+	auto [predictedFrom, predictedTo] = mPredictedReply;
+	auto rank = [&](const GameUtils::Move *move) {
+		return (move->from == predictedFrom && move->to == predictedTo) ? INT_MAX : move->score;
+	};
+
+	std::vector<size_t> order(mMoves.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return rank(mMoves[a]) > rank(mMoves[b]);
+	});
+	if (mode == PONDER_PREDICTED)
+		order.resize(1);
+
+	// the thread works on copies because mMoves belongs to the caller's thread
+	std::vector<std::pair<size_t, GameUtils::Disposition>> jobs;
+	jobs.reserve(order.size());
+	for (size_t i: order)
+		jobs.emplace_back(i, mMoves[i]->disposition);
+
+	// with a clock the search is not limited, so only the table is filled
+	SearchLimits limits = mTimeControl > 0 ? SearchLimits() : getDifficultyLimits(mGameDifficulty);
+	mPonderThread = std::thread([this, jobs = std::move(jobs), limits] {
+		for (const auto &[index, disposition]: jobs) {
+			if (mStopPonder) return;
+			mPonderReplies[index] = mEngine.calculateBestMove(disposition, limits, &mStopPonder);
+			if (mPonderReplies[index])
+				mEngine.getPredictedReply(mPonderPredictions[index].first, mPonderPredictions[index].second);
+		}
+	});
+}
+
+void MatchManager::stopPondering() {
+	if (!mPonderThread.joinable()) return;
+
+	mStopPonder = true;
+	mPonderThread.join();
+	mStopPonder = false;
+}
+
+void MatchManager::startHint() {
+	if (mMoves.empty()) return;
+
+	// the hint engine plays the player's side, the positions before the root are flipped as well
+	GameUtils::Disposition disposition = GameUtils::flip(mDisposition);
+	std::vector<uint64_t> keys = mHistory.getFlippedReversibleKeys(mHistory.getCurrent());
+	keys.pop_back();
+	mHintEngine.setGameHistory(keys);
+
+	// as strong as the PC, so the hint costs at most as much as a PC's move
+	SearchLimits limits;
+	limits.nodes = getDifficultyLimits(mGameDifficulty).nodes;
+	mHintThread = std::thread([this, disposition, limits] {
+#ifdef __linux__
+		// only this thread gets the lower priority
+		setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), HINT_NICE);
+#endif
+		// a single iterative deepening, the listener publishes the move of each iteration
+		GameUtils::Move *move = mHintEngine.calculateBestMove(disposition, limits, &mStopHint);
+		if (move == nullptr) return;
+
+		// a forced move is returned without iterations
+		mHint = (63 - move->from) * 64 + 63 - move->to;
+		delete move;
+	});
+}
+
+void MatchManager::HintListener::onIteration(const SearchLine &line, int) {
+	// the hint engine sees the chessboard flipped
+	mHint = (63 - line.from) * 64 + 63 - line.to;
+}
+
+void MatchManager::stopHint() {
+	if (mHintThread.joinable()) {
+		mStopHint = true;
+		mHintThread.join();
+		mStopHint = false;
+	}
+
+	mHint = -1;
+}
+
+void MatchManager::setHintEnabled(bool enabled) {
+	mHintEnabled = enabled;
+}
+
+void MatchManager::requestHint() {
+	Command command;
+	command.type = Command::HINT;
+	mCommands.push(command);
+}
+
+bool MatchManager::getHint(int &from, int &to) const {
+	int hint = mHint;
+	if (hint < 0) return false;
+
+	from = hint / 64;
+	to = hint % 64;
+	return true;
+}
+
+GameUtils::Move *MatchManager::takePonderedReply(const GameUtils::Move *playerMove) {
+	stopHint();
+	stopPondering();
+
+	// the principal variation of the engine is the one of the last pondered reply, not of this one
+	GameUtils::Move *reply = nullptr;
+	mPredictedReply = {-1, -1};
+	for (size_t i = 0; i < mPonderReplies.size(); i++) {
+		if (mMoves[i] == playerMove && mPonderReplies[i]) {
+			reply = mPonderReplies[i];
+			mPredictedReply = mPonderPredictions[i];
+		} else {
+			delete mPonderReplies[i];
+		}
+	}
+	mPonderReplies.clear();
+	mPonderPredictions.clear();
+
+	return reply;
+}
+
 void MatchManager::setDefaultLayout() {
 	for (int i = 0; i < 64; i++) {
 		if ((i / 8) % 2 == i % 2) {
@@ -212,36 +742,39 @@ void MatchManager::setDefaultLayout() {
 	}
 }
 
-GameUtils::Move *MatchManager::findPlayerMove(int oldIndex, int newIndex) {
-	GameUtils::PieceType oldValue, newValue;
+void MatchManager::findPlayerMoves() {
+	// deletes all moves before re-assignment
+	for (GameUtils::Move *move: mMoves)
+		delete move;
+	for (SquareMoves &square: mMoveIndex) {
+		square.targets.clear();
+		square.moves.clear();
+	}
 
-	// iterates the possible moves
+	mMoves = GameUtils::findMoves(mDisposition, true);
 	for (GameUtils::Move *move: mMoves) {
-		oldValue = move->disposition[oldIndex];
-		if (oldValue != GameUtils::EMPTY)
-			continue; // this is not the correct move
+		SquareMoves &square = mMoveIndex[move->from];
+		if (std::find(square.targets.begin(), square.targets.end(), move->to) == square.targets.end())
+			square.targets.push_back(move->to);
+
+		square.moves.push_back(PlayerMove{move, GameUtils::findPath(mDisposition, *move),
+		                                  GameUtils::findEaten(mDisposition, *move)});
+	}
+}
 
-		// here only if this move change the old position that becomes empty
-		newValue = move->disposition[newIndex];
-		if (newValue == GameUtils::PLAYER_PAWN || newValue == GameUtils::PLAYER_DAME)
-			return move; // this is the correct move from oldIndex to newIndex
+GameUtils::Move *MatchManager::findPlayerMove(int oldIndex, int newIndex) {
+	for (const PlayerMove &playerMove: mMoveIndex[oldIndex].moves) {
+		if (playerMove.move->to == newIndex)
+			return playerMove.move;
 	}
 
 	return nullptr;
 }
 
 bool MatchManager::highlightPossibleMoves(int from) {
-	bool isValid = false;
-	for (GameUtils::Move *move: mMoves) {
-		if (move->disposition[from] != GameUtils::EMPTY) continue; // wrong move
-		isValid = true;
-		for (int i = 0; i < 64; i++) {
-			if (mDisposition[i] == GameUtils::EMPTY && move->disposition[i] != GameUtils::EMPTY) {
-				// possible move
-				makeSquarePossibleMove(i);
-			}
-		}
-	}
+	const std::vector<int> &targets = mMoveIndex[from].targets;
+	if (targets.empty()) return false;
 
-	return isValid;
+	makeSquaresPossibleMove(targets);
+	return true;
 }
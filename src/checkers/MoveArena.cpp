@@ -0,0 +1,67 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/MoveArena.h"
+
+#include <algorithm>
+#include <new>
+
+// moves are trivially destructible, so releasing them does not need to call destructors
+static_assert(std::is_trivially_destructible_v<GameUtils::Move>);
+
+MoveArena::MoveArena(size_t size) : mCapacity(size / sizeof(GameUtils::Move)) {
+	// the memory is not touched until it is used
+	mBuffer.reset(new std::byte[mCapacity * sizeof(GameUtils::Move)]);
+}
+
+GameUtils::Move *MoveArena::create(const GameUtils::Disposition &disposition, bool eatenFromPawn, int score,
+                                   int from, int to) {
+	if (mTop == mCapacity) {
+		mOverflow = true;
+		return nullptr;
+	}
+
+	void *memory = mBuffer.get() + mTop * sizeof(GameUtils::Move);
+	mTop++;
+	mPeak = std::max(mPeak, mTop);
+	return new(memory) GameUtils::Move(disposition, eatenFromPawn, score, from, to);
+}
+
+size_t MoveArena::mark() const {
+	return mTop;
+}
+
+void MoveArena::release(size_t mark) {
+	mTop = mark;
+	mOverflow = false;
+}
+
+void MoveArena::reset() {
+	release(0);
+}
+
+bool MoveArena::hasOverflowed() const {
+	return mOverflow;
+}
+
+size_t MoveArena::getSize() const {
+	return mCapacity * sizeof(GameUtils::Move);
+}
+
+size_t MoveArena::getPeakUsage() const {
+	return mPeak * sizeof(GameUtils::Move);
+}
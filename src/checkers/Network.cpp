@@ -0,0 +1,220 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/Network.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define NETWORK_X86
+#endif
+
+#define NETWORK_MAGIC "CKNN"
+#define NETWORK_VERSION 1
+
+// the clipped ReLU of the hidden layer
+#define HIDDEN_MAX 127
+
+// bound of the output, with the material the score of the search stays far from the table's win score
+#define NETWORK_MAX_SCORE 16000
+
+static_assert(NETWORK_HIDDEN % 32 == 0, "the vector code processes 32 hidden values at a time");
+
+int Network::getInput(GameUtils::PieceType piece, int position) {
+	if (piece == GameUtils::EMPTY) return -1;
+	return (piece - 1) * 32 + position / 2;
+}
+
+static void updateScalar(const int16_t *weights, const Network::Accumulator &accumulator,
+                         const GameUtils::Disposition &before, const GameUtils::Disposition &after,
+                         Network::Accumulator &result) {
+	result = accumulator;
+	for (int position = 0; position < 64; position++) {
+		if (before[position] == after[position]) continue;
+
+		int removed = Network::getInput(before[position], position);
+		int added = Network::getInput(after[position], position);
+		for (int i = 0; i < NETWORK_HIDDEN; i++) {
+			if (removed >= 0) result.values[i] -= weights[removed * NETWORK_HIDDEN + i];
+			if (added >= 0) result.values[i] += weights[added * NETWORK_HIDDEN + i];
+		}
+	}
+}
+
+static int32_t outputScalar(const int8_t *outputWeights, const Network::Accumulator &accumulator) {
+	int32_t sum = 0;
+	for (int i = 0; i < NETWORK_HIDDEN; i++)
+		sum += std::clamp<int32_t>(accumulator.values[i], 0, HIDDEN_MAX) * outputWeights[i];
+
+	return sum;
+}
+
+#ifdef NETWORK_X86
+/**
+ * The accumulator stays in registers while the columns of the changed squares are applied
+ */
+__attribute__((target("avx2")))
+static void updateAvx2(const int16_t *weights, const Network::Accumulator &accumulator,
+                       const GameUtils::Disposition &before, const GameUtils::Disposition &after,
+                       Network::Accumulator &result) {
+	constexpr int REGISTERS = NETWORK_HIDDEN / 16;
+	__m256i values[REGISTERS];
+	for (int r = 0; r < REGISTERS; r++)
+		values[r] = _mm256_load_si256(reinterpret_cast<const __m256i *>(&accumulator.values[r * 16]));
+
+	for (int position = 0; position < 64; position += 8) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&before[position]));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&after[position]));
+		unsigned changed = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))) & 0xFF;
+		for (; changed; changed &= changed - 1) {
+			int square = position + __builtin_ctz(changed);
+			int removed = Network::getInput(before[square], square);
+			int added = Network::getInput(after[square], square);
+			for (int r = 0; r < REGISTERS; r++) {
+				if (removed >= 0)
+					values[r] = _mm256_sub_epi16(values[r], _mm256_loadu_si256(
+						reinterpret_cast<const __m256i *>(&weights[removed * NETWORK_HIDDEN + r * 16])));
+				if (added >= 0)
+					values[r] = _mm256_add_epi16(values[r], _mm256_loadu_si256(
+						reinterpret_cast<const __m256i *>(&weights[added * NETWORK_HIDDEN + r * 16])));
+			}
+		}
+	}
+
+	for (int r = 0; r < REGISTERS; r++)
+		_mm256_store_si256(reinterpret_cast<__m256i *>(&result.values[r * 16]), values[r]);
+}
+
+/**
+ * The clamped hidden values are packed to 8 bits and multiplied by the weights 32 at a time
+ */
+__attribute__((target("avx2")))
+static int32_t outputAvx2(const int8_t *outputWeights, const Network::Accumulator &accumulator) {
+	__m256i sum = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi16(1);
+	for (int i = 0; i < NETWORK_HIDDEN; i += 32) {
+		__m256i low = _mm256_load_si256(reinterpret_cast<const __m256i *>(&accumulator.values[i]));
+		__m256i high = _mm256_load_si256(reinterpret_cast<const __m256i *>(&accumulator.values[i + 16]));
+		low = _mm256_min_epi16(_mm256_max_epi16(low, _mm256_setzero_si256()), _mm256_set1_epi16(HIDDEN_MAX));
+		high = _mm256_min_epi16(_mm256_max_epi16(high, _mm256_setzero_si256()), _mm256_set1_epi16(HIDDEN_MAX));
+
+		// packing works in 128-bit lanes, the permutation restores the order of the hidden values
+		__m256i hidden = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+		__m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&outputWeights[i]));
+
+		// 127 * 128 * 2 fits in 16 bits, so the saturation of maddubs never applies
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(hidden, weights), ones));
+	}
+
+	__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(half);
+}
+#endif
+
+Network::Network(bool vectorized) : mHiddenBiases(NETWORK_HIDDEN), mWeights(NETWORK_INPUTS * NETWORK_HIDDEN),
+                                   mOutputWeights(NETWORK_HIDDEN), mUpdate(updateScalar), mOutput(outputScalar) {
+#ifdef NETWORK_X86
+	__builtin_cpu_init();
+	if (vectorized && __builtin_cpu_supports("avx2")) {
+		mVectorized = true;
+		mUpdate = updateAvx2;
+		mOutput = outputAvx2;
+	}
+#else
+	(void) vectorized;
+#endif
+}
+
+/**
+ * Reads little-endian values, their bytes are reversed on a big-endian host
+ */
+template<typename T>
+static bool readValues(std::ifstream &file, T *values, size_t count) {
+	file.read(reinterpret_cast<char *>(values), static_cast<std::streamsize>(count * sizeof(T)));
+	if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1) {
+		for (size_t i = 0; i < count; i++) {
+			auto *bytes = reinterpret_cast<unsigned char *>(&values[i]);
+			std::reverse(bytes, bytes + sizeof(T));
+		}
+	}
+
+	return file.good();
+}
+
+bool Network::load(const std::string &path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	char magic[4];
+	uint32_t header[3]; // version, inputs, hidden
+	if (!readValues(file, magic, 4) || std::memcmp(magic, NETWORK_MAGIC, 4) != 0 || !readValues(file, header, 3) ||
+	    header[0] != NETWORK_VERSION || header[1] != NETWORK_INPUTS || header[2] != NETWORK_HIDDEN)
+		return false;
+
+	std::vector<int16_t> hiddenBiases(NETWORK_HIDDEN), weights(NETWORK_INPUTS * NETWORK_HIDDEN);
+	std::vector<int8_t> outputWeights(NETWORK_HIDDEN);
+	int32_t outputBias;
+	if (!readValues(file, hiddenBiases.data(), hiddenBiases.size()) ||
+	    !readValues(file, weights.data(), weights.size()) ||
+	    !readValues(file, outputWeights.data(), outputWeights.size()) || !readValues(file, &outputBias, 1))
+		return false;
+
+	// nothing must follow the weights
+	if (file.peek() != std::ifstream::traits_type::eof())
+		return false;
+
+	mHiddenBiases = std::move(hiddenBiases);
+	mWeights = std::move(weights);
+	mOutputWeights = std::move(outputWeights);
+	mOutputBias = outputBias;
+	mLoaded = true;
+	return true;
+}
+
+bool Network::isLoaded() const {
+	return mLoaded;
+}
+
+bool Network::isVectorized() const {
+	return mVectorized;
+}
+
+void Network::refresh(const GameUtils::Disposition &disposition, Accumulator &accumulator) const {
+	std::copy(mHiddenBiases.begin(), mHiddenBiases.end(), accumulator.values.begin());
+
+	// the move from an empty board adds every piece
+	static constexpr GameUtils::Disposition empty{};
+	mUpdate(mWeights.data(), accumulator, empty, disposition, accumulator);
+}
+
+void Network::update(const Accumulator &accumulator, const GameUtils::Disposition &before,
+                     const GameUtils::Disposition &after, Accumulator &result) const {
+	mUpdate(mWeights.data(), accumulator, before, after, result);
+}
+
+int Network::evaluate(const Accumulator &accumulator) const {
+	// the bias of a file can be any value, the sum must not overflow
+	int64_t score = (static_cast<int64_t>(mOutputBias) + mOutput(mOutputWeights.data(), accumulator)) /
+	                NETWORK_OUTPUT_SCALE;
+	return static_cast<int>(std::clamp<int64_t>(score, -NETWORK_MAX_SCORE, NETWORK_MAX_SCORE));
+}
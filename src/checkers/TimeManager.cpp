@@ -0,0 +1,69 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/TimeManager.h"
+
+#include <algorithm>
+
+void TimeManager::start(long remaining, long increment, int movesToGo) {
+	mStart = std::chrono::steady_clock::now();
+	mStability = 1.0;
+	mForced = false;
+
+	long usable = std::max(remaining - MOVE_OVERHEAD, 0L);
+	int moves = movesToGo > 0 ? movesToGo : DEF_MOVES_TO_GO;
+
+	// most of the increment is spent, the rest of the time is split between the moves left
+	mOptimum = std::min(usable / moves + increment * 3 / 4, usable);
+	mHardLimit = std::min(mOptimum * 4, usable);
+	if (movesToGo != 1)
+		mHardLimit = std::min(mHardLimit, usable / 2 + increment);
+	mOptimum = std::min(mOptimum, mHardLimit);
+}
+
+void TimeManager::setForced() {
+	mForced = true;
+}
+
+void TimeManager::onIteration(bool bestMoveChanged) {
+	if (bestMoveChanged)
+		mStability = std::min(mStability + 0.5, 2.5); // unstable, think longer
+	else
+		mStability = std::max(mStability - 0.1, 0.5);
+}
+
+bool TimeManager::canStartIteration() const {
+	// the next iteration would probably take longer than the previous ones altogether
+	return !mForced && elapsed() < getSoftLimit() / 2;
+}
+
+bool TimeManager::isHardLimitReached() const {
+	return elapsed() >= mHardLimit;
+}
+
+long TimeManager::elapsed() const {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mStart).count();
+}
+
+long TimeManager::getSoftLimit() const {
+	if (mForced) return 0;
+	return std::min(static_cast<long>(mOptimum * mStability), mHardLimit);
+}
+
+long TimeManager::getHardLimit() const {
+	return mHardLimit;
+}
@@ -0,0 +1,214 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/TrainingData.h"
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TRAINING_MMAP
+#endif
+
+#define TRAINING_MAGIC "CKTD"
+#define TRAINING_VERSION 1
+#define TRAINING_HEADER_SIZE 16
+
+// records written at once
+#define WRITE_BUFFER_RECORDS 4096
+
+struct ShardHeader {
+	char magic[4];
+	uint32_t version, recordSize, reserved;
+};
+
+static_assert(sizeof(ShardHeader) == TRAINING_HEADER_SIZE);
+
+TrainingWriter::TrainingWriter(const std::string &prefix, size_t shardRecords) : mPrefix(prefix),
+                                                                                 mShardRecords(shardRecords) {
+	if (mShardRecords < 1) mShardRecords = 1;
+	mBuffer.reserve(WRITE_BUFFER_RECORDS);
+}
+
+TrainingWriter::~TrainingWriter() {
+	close();
+}
+
+bool TrainingWriter::write(const TrainingRecord &record) {
+	mBuffer.push_back(record);
+	if (mFileRecords + mBuffer.size() == mShardRecords) {
+		// the shard is full
+		return close();
+	}
+
+	if (mBuffer.size() == WRITE_BUFFER_RECORDS)
+		return flush();
+
+	return true;
+}
+
+bool TrainingWriter::close() {
+	bool ok = flush();
+	if (mFile.is_open()) {
+		mFile.close();
+		ok = ok && !mFile.fail();
+	}
+
+	mFileRecords = 0;
+	return ok;
+}
+
+size_t TrainingWriter::getShards() const {
+	return mShards;
+}
+
+bool TrainingWriter::flush() {
+	if (mBuffer.empty()) return true;
+
+	if (!mFile.is_open()) {
+		char suffix[16];
+		std::snprintf(suffix, sizeof(suffix), "-%05zu.bin", mShards);
+		mFile.open(mPrefix + suffix, std::ios::binary | std::ios::trunc);
+		if (!mFile) {
+			mBuffer.clear();
+			return false;
+		}
+		mShards++;
+
+		ShardHeader header{{}, TRAINING_VERSION, sizeof(TrainingRecord), 0};
+		std::memcpy(header.magic, TRAINING_MAGIC, 4);
+		mFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	}
+
+	mFile.write(reinterpret_cast<const char *>(mBuffer.data()),
+	            static_cast<std::streamsize>(mBuffer.size() * sizeof(TrainingRecord)));
+	mFileRecords += mBuffer.size();
+	mBuffer.clear();
+	return mFile.good();
+}
+
+/**
+ * Maps a file in memory, where mmap() is not available the file is read into a buffer
+ * @param size The size of the file
+ * @return The content of the file, or nullptr if it cannot be read or it is empty
+ */
+static void *mapFile(const std::string &path, size_t &size) {
+#ifdef TRAINING_MMAP
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return nullptr;
+
+	struct stat info{};
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		::close(fd);
+		return nullptr;
+	}
+
+	size = static_cast<size_t>(info.st_size);
+	void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps the file open
+	return mapping == MAP_FAILED ? nullptr : mapping;
+#else
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) return nullptr;
+
+	std::streamoff length = file.tellg();
+	if (length <= 0) return nullptr;
+
+	size = static_cast<size_t>(length);
+	char *buffer = new(std::nothrow) char[size];
+	if (!buffer) return nullptr;
+
+	file.seekg(0);
+	if (!file.read(buffer, length)) {
+		delete[] buffer;
+		return nullptr;
+	}
+
+	return buffer;
+#endif
+}
+
+/**
+ * Frees the memory of mapFile()
+ */
+static void unmapFile(void *mapping, size_t size) {
+#ifdef TRAINING_MMAP
+	munmap(mapping, size);
+#else
+	(void) size;
+	delete[] static_cast<char *>(mapping);
+#endif
+}
+
+TrainingReader::~TrainingReader() {
+	close();
+}
+
+bool TrainingReader::open(const std::string &path) {
+	close();
+
+	size_t size = 0;
+	void *mapping = mapFile(path, size);
+	if (!mapping) return false;
+
+	ShardHeader header{};
+	if (size >= TRAINING_HEADER_SIZE)
+		std::memcpy(&header, mapping, sizeof(header));
+	if (size < TRAINING_HEADER_SIZE || (size - TRAINING_HEADER_SIZE) % sizeof(TrainingRecord) != 0 ||
+	    std::memcmp(header.magic, TRAINING_MAGIC, 4) != 0 || header.version != TRAINING_VERSION ||
+	    header.recordSize != sizeof(TrainingRecord)) {
+		unmapFile(mapping, size);
+		return false;
+	}
+
+	mMapping = mapping;
+	mMappingSize = size;
+	mRecords = reinterpret_cast<const TrainingRecord *>(static_cast<const char *>(mapping) + TRAINING_HEADER_SIZE);
+	mSize = (size - TRAINING_HEADER_SIZE) / sizeof(TrainingRecord);
+	return true;
+}
+
+void TrainingReader::close() {
+	if (mMapping)
+		unmapFile(mMapping, mMappingSize);
+
+	mMapping = nullptr;
+	mMappingSize = 0;
+	mRecords = nullptr;
+	mSize = 0;
+}
+
+size_t TrainingReader::size() const {
+	return mSize;
+}
+
+const TrainingRecord &TrainingReader::operator[](size_t index) const {
+	return mRecords[index];
+}
+
+const TrainingRecord *TrainingReader::begin() const {
+	return mRecords;
+}
+
+const TrainingRecord *TrainingReader::end() const {
+	return mRecords + mSize;
+}
@@ -0,0 +1,168 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/TranspositionTable.h"
+
+#include <algorithm>
+#include <bit>
+
+#ifdef __linux__
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// size of the huge pages on x86-64 and of the common ARM64 configuration
+#define HUGE_PAGE_SIZE (2 << 20)
+
+// from <numaif.h>, so that libnuma is not required
+#define MPOL_INTERLEAVE 3
+
+/**
+ * @return A mask of the online NUMA nodes (only the first 64 nodes), 0 if it is not available
+ */
+static unsigned long onlineNumaNodes() {
+	// list of ranges, such as "0-1,4"
+	std::ifstream file("/sys/devices/system/node/online");
+	std::string range;
+	unsigned long mask = 0;
+	while (std::getline(file, range, ',')) {
+		size_t dash = range.find('-');
+		try {
+			unsigned long first = std::stoul(range.substr(0, dash));
+			unsigned long last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+			for (unsigned long node = first; node <= last && node < 64; node++)
+				mask |= 1UL << node;
+		} catch (const std::exception &) {
+			return 0;
+		}
+	}
+
+	return mask;
+}
+#endif
+
+TranspositionTable::TranspositionTable(size_t size, bool interleave) {
+	size = std::bit_floor(size < 1 ? 1 : size);
+	allocate(size, interleave);
+	mMask = size - 1;
+	clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+#ifdef __linux__
+	if (mMappedSize > 0) {
+		munmap(mEntries, mMappedSize);
+		return;
+	}
+#endif
+	delete[] mEntries;
+}
+
+void TranspositionTable::allocate(size_t size, bool interleave) {
+#ifdef __linux__
+	size_t bytes = size * sizeof(Entry);
+	if (bytes >= HUGE_PAGE_SIZE) {
+		size_t length = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+		void *memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED) {
+			mPages = PAGES_HUGE;
+		} else {
+			// no huge pages reserved: map normal pages aligned to a huge page, so that they can be merged
+			length += HUGE_PAGE_SIZE;
+			memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (memory != MAP_FAILED) {
+				auto address = reinterpret_cast<uintptr_t>(memory);
+				uintptr_t aligned = (address + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+				if (aligned > address)
+					munmap(memory, aligned - address);
+				length -= HUGE_PAGE_SIZE;
+				if (address + HUGE_PAGE_SIZE > aligned)
+					munmap(reinterpret_cast<void *>(aligned + length), address + HUGE_PAGE_SIZE - aligned);
+				memory = reinterpret_cast<void *>(aligned);
+
+				if (madvise(memory, length, MADV_HUGEPAGE) == 0)
+					mPages = PAGES_TRANSPARENT_HUGE;
+			}
+		}
+
+		if (memory != MAP_FAILED) {
+#ifdef SYS_mbind
+			// the policy is set before the pages are touched by clear()
+			unsigned long nodes = interleave ? onlineNumaNodes() : 0;
+			if (std::popcount(nodes) > 1)
+				mInterleaved = syscall(SYS_mbind, memory, length, MPOL_INTERLEAVE, &nodes,
+				                       sizeof(nodes) * 8, 0) == 0;
+#endif
+			mEntries = static_cast<Entry *>(memory);
+			mMappedSize = length;
+			return;
+		}
+	}
+#else
+	(void) interleave; // the first thread that touches the memory decides where it is
+#endif
+
+	mEntries = new Entry[size];
+}
+
+TranspositionTable::Pages TranspositionTable::getPages() const {
+	return mPages;
+}
+
+bool TranspositionTable::isInterleaved() const {
+	return mInterleaved;
+}
+
+size_t TranspositionTable::getSize() const {
+	return (mMask + 1) * sizeof(Entry);
+}
+
+void TranspositionTable::clear() {
+	std::fill(mEntries, mEntries + mMask + 1, Entry{0, 0, 0, BOUND_NONE, -1, -1, 0});
+	mGeneration = 0;
+}
+
+void TranspositionTable::newSearch() {
+	mGeneration++;
+}
+
+const TranspositionTable::Entry *TranspositionTable::probe(uint64_t key) const {
+	const Entry &entry = mEntries[key & mMask];
+	if (entry.bound == BOUND_NONE || entry.key != key)
+		return nullptr;
+
+	return &entry;
+}
+
+void TranspositionTable::store(uint64_t key, int score, int depth, Bound bound, int from, int to) {
+	Entry &entry = mEntries[key & mMask];
+
+	// a shallower result of the current search does not replace a deeper one
+	if (entry.bound != BOUND_NONE && entry.generation == mGeneration && entry.key != key && entry.depth > depth)
+		return;
+
+	// keep the old best move if the new result does not have one
+	if (entry.key == key && from == -1) {
+		from = entry.from;
+		to = entry.to;
+	}
+
+	entry = Entry{key, static_cast<int16_t>(score), static_cast<int8_t>(depth), bound,
+	              static_cast<int8_t>(from), static_cast<int8_t>(to), mGeneration};
+}
@@ -0,0 +1,100 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "checkers/Engine.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// exit code of a skipped test, see SKIP_RETURN_CODE in CMakeLists.txt
+#define SKIP_CODE 77
+
+/**
+ * @return Number of online NUMA nodes, 0 if it is not available
+ */
+static int onlineNumaNodes() {
+	// list of ranges, such as "0-1,4"
+	std::ifstream file("/sys/devices/system/node/online");
+	std::string range;
+	int nodes = 0;
+	while (std::getline(file, range, ',')) {
+		size_t dash = range.find('-');
+		try {
+			int first = std::stoi(range.substr(0, dash));
+			int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+			nodes += last - first + 1;
+		} catch (const std::exception &) {
+			return 0;
+		}
+	}
+
+	return nodes;
+}
+
+/**
+ * An engine with the transposition table interleaved among the NUMA nodes must find the same score as one
+ * with the table on the node of the thread. The table must be interleaved on a machine with more NUMA nodes,
+ * on a single node the test is skipped after comparing the scores
+ */
+int main() {
+	GameUtils::Disposition disposition{};
+	for (int position = 0; position < 64; position++) {
+		if ((position / 8) % 2 != position % 2)
+			disposition[position] = GameUtils::EMPTY;
+		else if (position < 24)
+			disposition[position] = GameUtils::PC_PAWN;
+		else if (position >= 40)
+			disposition[position] = GameUtils::PLAYER_PAWN;
+		else
+			disposition[position] = GameUtils::EMPTY;
+	}
+
+	EngineConfig config;
+	config.ttSize = 4 << 20; // large enough to be mapped, where it can be interleaved
+	config.arenaSize = 1 << 20;
+	config.selectiveSearch = false; // the reductions depend on the random order of the moves
+	Engine local(config);
+	config.interleaveTable = true;
+	Engine interleaved(config);
+
+	int failures = 0;
+	for (int depth = 1; depth <= 6; depth++) {
+		delete local.calculateBestMove(disposition, depth);
+		delete interleaved.calculateBestMove(disposition, depth);
+		EngineStats localStats = local.getStats(), interleavedStats = interleaved.getStats();
+		if (localStats.score != interleavedStats.score || localStats.depth != interleavedStats.depth ||
+		    localStats.ttInterleaved) {
+			std::cerr << "depth " << depth << ": score " << interleavedStats.score << " instead of "
+			          << localStats.score << '\n';
+			failures++;
+		}
+	}
+
+	if (failures) return 1;
+
+	int nodes = onlineNumaNodes();
+	if (nodes <= 1) {
+		std::cout << "skipped: " << (nodes == 1 ? "a single NUMA node" : "the NUMA nodes are unknown") << '\n';
+		return SKIP_CODE;
+	}
+
+	if (!interleaved.getStats().ttInterleaved) {
+		std::cerr << "table not interleaved among " << nodes << " NUMA nodes\n";
+		return 1;
+	}
+
+	return 0;
+}
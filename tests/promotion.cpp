@@ -0,0 +1,55 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "checkers/Engine.h"
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+/**
+ * A PC's pawn can promote or another one can make a quiet move: the promotion must never score less than the
+ * quiet move, and more when the search ends right after the move
+ */
+int main() {
+	GameUtils::Disposition disposition{};
+	disposition.fill(GameUtils::EMPTY);
+	disposition[16] = GameUtils::PC_PAWN;
+	disposition[50] = GameUtils::PC_PAWN;
+	disposition[31] = GameUtils::PLAYER_PAWN;
+
+	EngineConfig config;
+	config.ttSize = 1 << 20;
+	config.arenaSize = 1 << 20;
+	Engine engine(config);
+
+	int failures = 0;
+	for (int depth = 0; depth <= 6; depth++) {
+		int promotion = INT_MIN, quiet = INT_MIN;
+		for (const SearchLine &line: engine.analyze(disposition, 3, depth, nullptr, nullptr)) {
+			if (line.from == 50 && line.to / 8 == 7)
+				promotion = std::max(promotion, line.score);
+			else if (line.from == 16 && line.to == 25)
+				quiet = line.score;
+		}
+
+		if (promotion == INT_MIN || quiet == INT_MIN || promotion < quiet || (depth == 0 && promotion == quiet)) {
+			std::cerr << "depth " << depth << ": promotion " << promotion << ", quiet move " << quiet << '\n';
+			failures++;
+		}
+	}
+
+	return failures ? 1 : 0;
+}
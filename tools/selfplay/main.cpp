@@ -0,0 +1,218 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/Engine.h"
+#include "checkers/GameHistory.h"
+#include "checkers/TrainingData.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a game longer than this is adjudicated as a draw
+#define MAX_GAME_PLIES 300
+
+// scores of won positions in the records
+#define RECORD_WIN 32000
+
+struct Options {
+	long games = 1000;
+	int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	int depth = 6;
+	int randomPlies = 8; // random moves at the beginning of each game
+	size_t shardRecords = 1 << 20;
+	size_t ttSize = 16 << 20; // bytes for each thread
+	std::string output = "selfplay";
+};
+
+static option longOptions[] = {
+		{"games",         required_argument, nullptr, 'g'},
+		{"threads",       required_argument, nullptr, 'j'},
+		{"depth",         required_argument, nullptr, 'd'},
+		{"random-plies",  required_argument, nullptr, 'r'},
+		{"shard-records", required_argument, nullptr, 's'},
+		{"hash",          required_argument, nullptr, 'm'},
+		{"output",        required_argument, nullptr, 'o'},
+		{"help",          no_argument,       nullptr, 'h'},
+		{nullptr,         0,                 nullptr, 0}
+};
+
+static GameUtils::Disposition startingDisposition() {
+	GameUtils::Disposition disposition{};
+	for (int position = 0; position < 64; position++) {
+		if ((position / 8) % 2 != position % 2) continue;
+		if (position < 24) disposition[position] = GameUtils::PC_PAWN;
+		else if (position >= 40) disposition[position] = GameUtils::PLAYER_PAWN;
+	}
+
+	return disposition;
+}
+
+/**
+ * Plays a game and writes its searched positions
+ * @return The number of records written, or -1 if they cannot be written
+ */
+static long playGame(Engine &engine, TrainingWriter &writer, std::mt19937_64 &random, const Options &options) {
+	GameUtils::Disposition disposition = startingDisposition();
+	GameHistory history;
+	history.reset(disposition, random() % 2);
+	engine.newGame();
+
+	std::vector<TrainingRecord> records;
+	int result = 0;
+	for (int ply = 0; ply < MAX_GAME_PLIES; ply++) {
+		bool pcTurn = history.getPly(history.getCurrent()).pcTurn;
+		if (history.isDraw(history.getCurrent()))
+			break;
+
+		GameUtils::MoveList moves = GameUtils::findMoves(disposition, !pcTurn);
+		if (moves.empty()) {
+			// who cannot move loses
+			result = pcTurn ? -1 : 1;
+			for (GameUtils::Move *move: moves) delete move;
+			break;
+		}
+
+		GameUtils::Disposition next;
+		int from, to;
+		if (ply < options.randomPlies) {
+			const GameUtils::Move *move = moves[random() % moves.size()];
+			next = move->disposition;
+			from = move->from;
+			to = move->to;
+		} else {
+			// the engine always plays the PC, the player's positions are flipped
+			GameUtils::Move *move = engine.calculateBestMove(pcTurn ? disposition : GameUtils::flip(disposition),
+			                                                 options.depth);
+			next = pcTurn ? move->disposition : GameUtils::flip(move->disposition);
+			from = pcTurn ? move->from : 63 - move->from;
+			to = pcTurn ? move->to : 63 - move->to;
+			delete move;
+
+			// forced moves are not searched, so they have no score
+			EngineStats stats = engine.getStats();
+			if (stats.depth > 0) {
+				int score = std::clamp(stats.score, -RECORD_WIN, RECORD_WIN);
+				const GameHistory::Ply &current = history.getPly(history.getCurrent());
+				records.push_back(TrainingRecord{current.pc, current.player, current.dames,
+				                                 static_cast<int16_t>(pcTurn ? score : -score), 0,
+				                                 static_cast<uint8_t>(pcTurn ? TRAINING_PC_TURN : 0)});
+			}
+		}
+
+		for (GameUtils::Move *move: moves) delete move;
+		history.push(next, from, to);
+		disposition = next;
+	}
+
+	for (TrainingRecord &record: records) {
+		record.result = static_cast<int8_t>(result);
+		if (!writer.write(record))
+			return -1;
+	}
+
+	return static_cast<long>(records.size());
+}
+
+static void printHelpMessage(const char *name) {
+	std::cout << "Usage: " << name << " [OPTIONS]" << std::endl;
+	std::cout << "Plays games against itself and writes the searched positions for training" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -g, --games=N              Number of games (default 1000)" << std::endl;
+	std::cout << "  -j, --threads=N            Games played in parallel (default: number of CPUs)" << std::endl;
+	std::cout << "  -d, --depth=N              Depth of the search (default 6)" << std::endl;
+	std::cout << "  -r, --random-plies=N       Random moves at the beginning of each game (default 8)" << std::endl;
+	std::cout << "  -s, --shard-records=N      Records of each output file (default 1048576)" << std::endl;
+	std::cout << "  -m, --hash=MIB             Transposition table of each thread in MiB (default 16)" << std::endl;
+	std::cout << "  -o, --output=PREFIX        Output files are PREFIX-THREAD-SHARD.bin (default selfplay)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	int c;
+	while ((c = getopt_long(argc, argv, ":g:j:d:r:s:m:o:h", longOptions, nullptr)) != -1) {
+		switch (c) {
+			case 'g':
+				options.games = std::atol(optarg);
+				break;
+			case 'j':
+				options.threads = std::max(1, std::atoi(optarg));
+				break;
+			case 'd':
+				options.depth = std::clamp(std::atoi(optarg), 1, MAX_DEPTH);
+				break;
+			case 'r':
+				options.randomPlies = std::max(0, std::atoi(optarg));
+				break;
+			case 's':
+				options.shardRecords = std::strtoul(optarg, nullptr, 10);
+				break;
+			case 'm':
+				options.ttSize = std::strtoul(optarg, nullptr, 10) << 20;
+				break;
+			case 'o':
+				options.output = optarg;
+				break;
+			case 'h':
+				printHelpMessage(argv[0]);
+				return EXIT_SUCCESS;
+			default:
+				std::cerr << "Error parsing arguments" << std::endl;
+				return EXIT_FAILURE;
+		}
+	}
+
+	// the games are taken from a shared counter, so that faster threads play more
+	std::atomic<long> nextGame = 0, positions = 0;
+	std::atomic<bool> failed = false;
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < options.threads; thread++) {
+		threads.emplace_back([&, thread]() {
+			EngineConfig config;
+			config.ttSize = options.ttSize;
+			Engine engine(config);
+			TrainingWriter writer(options.output + "-" + std::to_string(thread), options.shardRecords);
+			std::random_device seed;
+			std::mt19937_64 random(seed() ^ thread);
+
+			while (!failed && nextGame.fetch_add(1) < options.games) {
+				long records = playGame(engine, writer, random, options);
+				if (records < 0) failed = true;
+				else positions += records;
+			}
+
+			if (!writer.close()) failed = true;
+		});
+	}
+
+	for (std::thread &thread: threads)
+		thread.join();
+
+	if (failed) {
+		std::cerr << "Cannot write the output files" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << positions << " positions written" << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,305 @@
+/*
+    Copyright (C) 2023-2024  Nicola Revelant
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "checkers/Evaluator.h"
+#include "checkers/TrainingData.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define MAX_PIECES 24
+
+// the bonuses of the pawns, then the ones of the dames
+#define PARAMETERS 64
+
+// feature of a player's piece, that subtracts the parameter
+#define FEATURE_PLAYER 0x80
+
+/**
+ * A position of the corpus, compact so that two of them fit in a cache line
+ */
+struct Sample {
+	float target; // expected result from 0 (player won) to 1 (PC won)
+	int16_t material;
+	uint8_t count;
+	uint8_t features[MAX_PIECES + 1]; // parameter of each piece, with FEATURE_PLAYER for the player's ones
+};
+
+static_assert(sizeof(Sample) == 32);
+
+typedef std::array<double, PARAMETERS> Parameters;
+
+/**
+ * Partial sums of a thread, padded to avoid sharing cache lines between threads
+ */
+struct alignas(64) Partial {
+	double error;
+	Parameters gradient;
+};
+
+struct Options {
+	int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	int iterations = 500;
+	double learningRate = 1;
+	double lambda = 0.5; // weight of the result in the target, the rest is the search score
+	std::string input; // initial weights
+	std::string output = "weights";
+};
+
+static option longOptions[] = {
+		{"threads",       required_argument, nullptr, 'j'},
+		{"iterations",    required_argument, nullptr, 'n'},
+		{"learning-rate", required_argument, nullptr, 'a'},
+		{"lambda",        required_argument, nullptr, 'l'},
+		{"weights",       required_argument, nullptr, 'w'},
+		{"output",        required_argument, nullptr, 'o'},
+		{"help",          no_argument,       nullptr, 'h'},
+		{nullptr,         0,                 nullptr, 0}
+};
+
+/**
+ * @return The expected result of a score, from 0 to 1
+ */
+static double sigmoid(double score, double k) {
+	return 1 / (1 + std::pow(10.0, -k * score / 400));
+}
+
+static int toPosition(int square) {
+	return square * 2 + (square / 4) % 2;
+}
+
+static Sample toSample(const TrainingRecord &record, double lambda) {
+	Sample sample{};
+	sample.target = static_cast<float>(lambda * (record.result + 1) / 2 +
+	                                     (1 - lambda) * sigmoid(record.score, 1));
+
+	int material = 0;
+	for (int square = 0; square < 32; square++) {
+		uint32_t bit = 1u << square;
+		bool dame = record.dames & bit;
+		if (record.pc & bit) {
+			material += dame ? DAME_SCORE : PAWN_SCORE;
+			sample.features[sample.count++] = static_cast<uint8_t>((dame ? 32 : 0) + square);
+		} else if (record.player & bit) {
+			// the player's tables are the PC's ones with the chessboard rotated
+			int rotated = (63 - toPosition(square)) / 2;
+			material -= dame ? DAME_SCORE : PAWN_SCORE;
+			sample.features[sample.count++] = static_cast<uint8_t>(FEATURE_PLAYER | ((dame ? 32 : 0) + rotated));
+		}
+	}
+
+	sample.material = static_cast<int16_t>(material);
+	return sample;
+}
+
+static double evaluate(const Sample &sample, const Parameters &weights) {
+	double score = sample.material;
+	for (int i = 0; i < sample.count; i++) {
+		uint8_t feature = sample.features[i];
+		double weight = weights[feature & ~FEATURE_PLAYER];
+		score += (feature & FEATURE_PLAYER) ? -weight : weight;
+	}
+
+	return score;
+}
+
+/**
+ * Splits [0, size) among the threads
+ */
+template<typename Function>
+static void parallelFor(int threads, size_t size, Function function) {
+	std::vector<std::thread> workers;
+	size_t chunk = (size + threads - 1) / threads;
+	for (int thread = 0; thread < threads; thread++) {
+		size_t begin = std::min(size, thread * chunk), end = std::min(size, begin + chunk);
+		workers.emplace_back(function, thread, begin, end);
+	}
+
+	for (std::thread &worker: workers)
+		worker.join();
+}
+
+/**
+ * @param gradient If not nullptr, filled with the gradient of the error
+ * @return The mean squared error of the predictions
+ */
+static double computeError(const std::vector<Sample> &samples, const Parameters &weights, double k,
+                           int threads, Parameters *gradient) {
+	std::vector<Partial> partials(threads);
+	parallelFor(threads, samples.size(), [&](int thread, size_t begin, size_t end) {
+		Partial partial{};
+		for (size_t i = begin; i < end; i++) {
+			const Sample &sample = samples[i];
+			double predicted = sigmoid(evaluate(sample, weights), k);
+			double difference = predicted - sample.target;
+			partial.error += difference * difference;
+			if (!gradient) continue;
+
+			// derivative of the squared error with respect to the score
+			double slope = 2 * difference * predicted * (1 - predicted) * k * std::log(10.0) / 400;
+			for (int f = 0; f < sample.count; f++) {
+				uint8_t feature = sample.features[f];
+				partial.gradient[feature & ~FEATURE_PLAYER] += (feature & FEATURE_PLAYER) ? -slope : slope;
+			}
+		}
+		partials[thread] = partial;
+	});
+
+	double error = 0;
+	if (gradient) gradient->fill(0);
+	for (const Partial &partial: partials) {
+		error += partial.error;
+		if (!gradient) continue;
+		for (int p = 0; p < PARAMETERS; p++)
+			(*gradient)[p] += partial.gradient[p] / static_cast<double>(samples.size());
+	}
+
+	return error / static_cast<double>(samples.size());
+}
+
+/**
+ * Finds the scale of the sigmoid that best fits the initial weights
+ */
+static double fitScale(const std::vector<Sample> &samples, const Parameters &weights, int threads) {
+	double low = 0.01, high = 4;
+	for (int i = 0; i < 40; i++) {
+		double a = low + (high - low) / 3, b = high - (high - low) / 3;
+		if (computeError(samples, weights, a, threads, nullptr) < computeError(samples, weights, b, threads, nullptr))
+			high = b;
+		else
+			low = a;
+	}
+
+	return (low + high) / 2;
+}
+
+static void printHelpMessage(const char *name) {
+	std::cout << "Usage: " << name << " [OPTIONS] SHARD..." << std::endl;
+	std::cout << "Tunes the weights of the evaluation on the positions written by selfplay" << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -j, --threads=N            Threads (default: number of CPUs)" << std::endl;
+	std::cout << "  -n, --iterations=N         Iterations of the gradient descent (default 500)" << std::endl;
+	std::cout << "  -a, --learning-rate=RATE   Step of the gradient descent (default 1)" << std::endl;
+	std::cout << "  -l, --lambda=LAMBDA        Weight of the game result in the target, from 0 to 1 (default 0.5)"
+	          << std::endl;
+	std::cout << "  -w, --weights=FILE         Initial weights (default: the built-in ones)" << std::endl;
+	std::cout << "  -o, --output=FILE          Output weights file (default weights)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	int c;
+	while ((c = getopt_long(argc, argv, ":j:n:a:l:w:o:h", longOptions, nullptr)) != -1) {
+		switch (c) {
+			case 'j':
+				options.threads = std::max(1, std::atoi(optarg));
+				break;
+			case 'n':
+				options.iterations = std::max(0, std::atoi(optarg));
+				break;
+			case 'a':
+				options.learningRate = std::atof(optarg);
+				break;
+			case 'l':
+				options.lambda = std::clamp(std::atof(optarg), 0.0, 1.0);
+				break;
+			case 'w':
+				options.input = optarg;
+				break;
+			case 'o':
+				options.output = optarg;
+				break;
+			case 'h':
+				printHelpMessage(argv[0]);
+				return EXIT_SUCCESS;
+			default:
+				std::cerr << "Error parsing arguments" << std::endl;
+				return EXIT_FAILURE;
+		}
+	}
+
+	Evaluator::Weights initial = Evaluator::getDefaultWeights();
+	if (!options.input.empty() && !Evaluator::readWeights(options.input, initial)) {
+		std::cerr << "Invalid weights file: " << options.input << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// the shards are mapped, so only the compact samples are kept in memory
+	std::vector<Sample> samples;
+	for (int i = optind; i < argc; i++) {
+		TrainingReader reader;
+		if (!reader.open(argv[i])) {
+			std::cerr << "Invalid shard: " << argv[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		samples.reserve(samples.size() + reader.size());
+		for (const TrainingRecord &record: reader)
+			samples.push_back(toSample(record, options.lambda));
+	}
+
+	if (samples.empty()) {
+		std::cerr << "No positions" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Parameters weights;
+	for (int square = 0; square < 32; square++) {
+		weights[square] = initial.pawn[square];
+		weights[32 + square] = initial.dame[square];
+	}
+
+	double k = fitScale(samples, weights, options.threads);
+	std::cout << samples.size() << " positions, scale " << k << ", error "
+	          << computeError(samples, weights, k, options.threads, nullptr) << std::endl;
+
+	// Adam optimizer
+	constexpr double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+	Parameters gradient, moment{}, velocity{};
+	for (int iteration = 1; iteration <= options.iterations; iteration++) {
+		double error = computeError(samples, weights, k, options.threads, &gradient);
+		for (int p = 0; p < PARAMETERS; p++) {
+			moment[p] = beta1 * moment[p] + (1 - beta1) * gradient[p];
+			velocity[p] = beta2 * velocity[p] + (1 - beta2) * gradient[p] * gradient[p];
+			double correctedMoment = moment[p] / (1 - std::pow(beta1, iteration));
+			double correctedVelocity = velocity[p] / (1 - std::pow(beta2, iteration));
+			weights[p] -= options.learningRate * correctedMoment / (std::sqrt(correctedVelocity) + epsilon);
+		}
+
+		if (iteration % 50 == 0 || iteration == options.iterations)
+			std::cout << "iteration " << iteration << ", error " << error << std::endl;
+	}
+
+	Evaluator::Weights tuned{};
+	for (int square = 0; square < 32; square++) {
+		tuned.pawn[square] = static_cast<int32_t>(std::lround(weights[square]));
+		tuned.dame[square] = static_cast<int32_t>(std::lround(weights[32 + square]));
+	}
+
+	if (!Evaluator::writeWeights(options.output, tuned)) {
+		std::cerr << "Cannot write " << options.output << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}